@@ -3,137 +3,227 @@
 #include "include/constants.h"
 #include "include/data.h"
 #include "include/entities.h"
+#include "include/tiles.h"
+#include <algorithm>
+#include <cmath>
 #include <raylib.h>
 
-void BehaveSystem(EntityManager &em, size_t i) {
-    // 1. Identify the entity and its configuration
-    int id = em.rendering.typeID[i];
-    auto nameIt = IdToName.find(id);
-    if (nameIt == IdToName.end())
-        return;
-
-    auto cfgIt = em.ConfigMap.find(nameIt->second);
-    if (cfgIt == em.ConfigMap.end())
-        return;
-
-    const EntityConfig &cfg = cfgIt->second;
-
-    auto &v = em.vars[i];
-
-    for (auto const &[behavior, behaviorValue] : cfg.customBehs) {
-        // --- Tile Behaviors ---
-        if (behavior == "one_way") {
-            if (em.rendering.varID[i] == 0) {
-            } else if (em.rendering.varID[i] == 1) {
-            } else if (em.rendering.varID[i] == 2) {
-            } else if (em.rendering.varID[i] == 3) {
-            }
-        }
-
-        // --- Enemy Behaviors ---
-        if (behavior == "flip_on_wall") {
-            if (!em.physics.initialized[i]) {
-                if (v.has("MAX_SPEED")) {
-                    em.physics.vel[i].x = v.get("MAX_SPEED");
-                } else {
-                    em.physics.vel[i].x = 100.0f;
-                }
-                em.physics.initialized[i] = true;
-                return;
-            }
-            if (em.physics.walled[i]) {
-                em.physics.vel[i].x *= -1.0f;
-                em.SyncRect(em, i);
+// --- Enemy Behaviors ---
+static void BehaveFlipOnWall(EntityManager &em,
+                             const std::vector<size_t> &batch, float /*dt*/) {
+    for (size_t i : batch) {
+        auto &v = em.vars[i];
+
+        if (!em.physics.initialized[i]) {
+            if (v.has(Var::MAX_SPEED)) {
+                em.physics.vel[i].x = v.get(Var::MAX_SPEED);
+            } else {
+                em.physics.vel[i].x = 100.0f;
             }
+            em.physics.initialized.set(i, true);
+            continue;
         }
-
-        if (behavior == "jump_on_ground") {
-            if (em.physics.grounded[i]) {
-                if (v.has("JUMP_VAR")) {
-                    float jumpVel = v.get("JUMP_VAR");
-                    em.physics.vel[i].y = jumpVel;
-                } else if (cfg.customVars.count("JUMP_VAR")) {
-                    em.physics.vel[i].y = cfg.customVars.at("JUMP_VAR");
-                }
-            }
+        if (em.physics.walled[i]) {
+            em.physics.vel[i].x *= -1.0f;
+            em.SyncRect(em, i);
         }
+    }
+}
 
-        if (behavior == "jump_on_wall") {
-            Rectangle wallRect = {
-                em.physics.pos[i].x - em.physics.siz[i].x * 1.25f,
-                em.physics.pos[i].y + em.physics.siz[i].y / 2.0f,
-                em.physics.siz[i].x * 1.5f,
-                2.0f,
-            };
-
-            auto colRes = cS.CheckCollisions(em, wallRect, i);
+static void BehaveFlipOnEdge(EntityManager &em,
+                             const std::vector<size_t> &batch, float dt) {
+    for (size_t i : batch) {
+        float velX = em.physics.vel[i].x;
+        if (!em.physics.grounded[i] || velX == 0.0f)
+            continue;
+
+        // Turn back when the front edge would be past the ground's end
+        // after the next step. dt spans every tick until the next turn,
+        // which is several for rows in the middle LOD ring.
+        float step = std::max(std::abs(velX) * dt, 1.0f);
+        Rectangle ahead = em.physics.rect[i];
+        ahead.x += std::copysign(step - 1.0f, velX);
+        if (tmap.LedgeAhead(ahead, velX, 1.0f))
+            em.physics.vel[i].x = -velX;
+    }
+}
 
-            if (colRes.typeID != EntityTys::TYTILE)
-                return;
+static void BehaveJumpOnGround(EntityManager &em,
+                               const std::vector<size_t> &batch, float /*dt*/) {
+    for (size_t i : batch) {
+        auto &v = em.vars[i];
 
-            if (em.physics.grounded[i]) {
-                em.physics.vel[i].y = v.get("JUMP_VAR");
-            }
+        if (em.physics.grounded[i] && v.has(Var::JUMP_VAR)) {
+            em.physics.vel[i].y = v.get(Var::JUMP_VAR);
         }
+    }
+}
 
-        if (behavior == "chase_player") {
-            float chaseSize = 400.0f;
-            Rectangle chaseRect = {em.physics.pos[i].x - chaseSize / 2,
-                                   em.physics.pos[i].y - chaseSize / 2,
-                                   chaseSize, chaseSize};
+static void BehaveJumpOnWall(EntityManager &em,
+                             const std::vector<size_t> &batch, float /*dt*/) {
+    for (size_t i : batch) {
+        if (!em.physics.grounded[i])
+            continue;
 
-            auto colRes = cS.CheckCollisions(em, chaseRect, i);
+        // A wall at waist height within a quarter body width ahead
+        Rectangle waist = {em.physics.pos[i].x,
+                           em.physics.pos[i].y + em.physics.siz[i].y / 2.0f,
+                           em.physics.siz[i].x, 2.0f};
 
-            if (colRes.typeID != EntityTys::TYCHARACTER)
-                return;
+        if (tmap.WallAhead(waist, em.physics.vel[i].x,
+                           em.physics.siz[i].x * 0.25f)) {
+            em.physics.vel[i].y = em.vars[i].get(Var::JUMP_VAR);
+        }
+    }
+}
 
-            if (em.physics.pos[i].x > colRes.pos.x) {
-                em.physics.vel[i].x = v.get("MAX_SPEED");
-            } else if (em.physics.pos[i].x < colRes.pos.x) {
-                em.physics.vel[i].x = -v.get("MAX_SPEED");
-            }
+static void BehaveChasePlayer(EntityManager &em,
+                              const std::vector<size_t> &batch, float /*dt*/) {
+    const float chaseSize = 400.0f;
+
+    for (size_t i : batch) {
+        Rectangle chaseRect = {em.physics.pos[i].x - chaseSize / 2,
+                               em.physics.pos[i].y - chaseSize / 2, chaseSize,
+                               chaseSize};
+
+        QueryFilter filter;
+        filter.layers = Layer::PLAYER;
+        filter.tiles = false;
+        QueryHit player;
+        if (cS.QueryAABB(em, chaseRect, filter, {&player, 1}) == 0)
+            continue;
+
+        float maxSpeed = em.vars[i].get(Var::MAX_SPEED);
+        if (em.physics.pos[i].x > player.rect.x) {
+            em.physics.vel[i].x = -maxSpeed;
+        } else if (em.physics.pos[i].x < player.rect.x) {
+            em.physics.vel[i].x = maxSpeed;
         }
     }
 }
 
-void BehaveDrawing(EntityManager &em, size_t i) {
-    int id = em.rendering.typeID[i];
-    auto nameIt = IdToName.find(id);
-    if (nameIt == IdToName.end())
-        return;
+static void DrawEnemy(EntityManager &em, const std::vector<size_t> &batch) {
+    for (size_t i : batch) {
+        Vector2 pos = em.RenderPos(i);
+        DrawText("ENEMY", pos.x, (pos.y - em.physics.siz[i].y / 2), 10,
+                 em.rendering.col[i]);
+    }
+}
 
-    auto cfgIt = em.ConfigMap.find(nameIt->second);
-    if (cfgIt == em.ConfigMap.end())
-        return;
+// Indexed by BehaveId; names must match entities.json
+const BehaveDef Behaves[BEH_COUNT] = {
+    {"chase_player", BehaveChasePlayer, nullptr},
+    {"enemy", nullptr, DrawEnemy},
+    {"flip_on_edge", BehaveFlipOnEdge, nullptr},
+    {"flip_on_wall", BehaveFlipOnWall, nullptr},
+    {"hazard", nullptr, nullptr},
+    {"jump_on_ground", BehaveJumpOnGround, nullptr},
+    {"jump_on_wall", BehaveJumpOnWall, nullptr},
+    {"one_way", nullptr, nullptr},
+    {"tile", nullptr, nullptr},
+};
+
+int FindBehave(const std::string &name) {
+    for (int b = 0; b < BEH_COUNT; ++b) {
+        if (name == Behaves[b].name)
+            return b;
+    }
+    return -1;
+}
 
-    const EntityConfig &cfg = cfgIt->second;
+uint32_t CompileBehaves(const std::map<std::string, float> &customBehs) {
+    uint32_t mask = 0;
+    for (auto const &[name, value] : customBehs) {
+        int b = FindBehave(name);
+        if (b < 0) {
+            TraceLog(LOG_WARNING, "BEHAVE: Unknown behavior [%s]",
+                     name.c_str());
+            continue;
+        }
+        mask |= 1u << b;
+    }
+    return mask;
+}
 
-    auto &v = em.vars[i];
+// Active entities bucketed by behavior bit, for rows that step `rate`
+// ticks at a time
+struct BehaveBatches {
+    uint32_t rate = 1;
+    std::vector<size_t> rows[BEH_COUNT];
+};
+
+// Buckets active entities by behavior bit; callers then hand each bucket to
+// its function in BehaveId order, one pass after another. Types with
+// nothing to run are skipped wholesale via their type bucket. Updates skip
+// dormant rows, and put rows in the middle LOD ring in a pass of their
+// own; drawing takes them all in the first pass.
+static std::vector<BehaveBatches> &CollectBehaves(EntityManager &em,
+                                                  bool drawing) {
+    static std::vector<BehaveBatches> passes(1); // passes[0] runs every tick
+    for (BehaveBatches &pass : passes) {
+        for (auto &batch : pass.rows)
+            batch.clear();
+    }
 
-    for (auto const &[behavior, behaviorValue] : cfg.customBehs) {
-        // --- Tile Behaviors ---
-        if (behavior == "one_way") {
-            if (em.rendering.varID[i] == 0) {
-            } else if (em.rendering.varID[i] == 1) {
-            } else if (em.rendering.varID[i] == 2) {
-            } else if (em.rendering.varID[i] == 3) {
-            }
-        }
+    uint32_t runnable = 0;
+    for (int b = 0; b < BEH_COUNT; ++b) {
+        if (drawing ? (bool)Behaves[b].draw : (bool)Behaves[b].update)
+            runnable |= 1u << b;
+    }
 
-        // --- Enemy Behaviors ---
-        if (behavior == "enemy") {
-            DrawText("ENEMY", em.physics.pos[i].x,
-                     (em.physics.pos[i].y - em.physics.siz[i].y / 2), 10,
-                     em.rendering.col[i]);
+    for (size_t t = 0; t < em.typeBuckets.size(); ++t) {
+        if ((em.typeBehaves[t] & runnable) == 0)
+            continue;
+
+        // Middle ring rows take a turn every `rate` ticks, staggered by
+        // slot so the ring's work is spread out, and step that many ticks
+        const EntityConfig *cfg = em.typeConfigs[t];
+        uint32_t rate = (!drawing && cfg) ? (uint32_t)cfg->lodRate : 1;
+        BehaveBatches *slow = nullptr;
+        if (rate > 1) {
+            auto it = std::find_if(
+                passes.begin(), passes.end(),
+                [&](const BehaveBatches &pass) { return pass.rate == rate; });
+            if (it == passes.end()) {
+                it = passes.emplace(passes.end());
+                it->rate = rate;
+            }
+            slow = &*it;
         }
 
-        if (behavior == "flip_on_wall") {
+        for (uint32_t slot : em.typeBuckets[t]) {
+            size_t i = em.sparse[slot];
+            if (!em.physics.active[i])
+                continue;
+            if (!drawing && em.physics.dormant[i])
+                continue;
+            BehaveBatches *pass = &passes[0];
+            if (slow && em.physics.reduced[i]) {
+                if ((em.lodTick + slot) % rate != 0)
+                    continue;
+                pass = slow;
+            }
+            for (uint32_t m = em.behs[i].mask & runnable; m; m &= m - 1)
+                pass->rows[std::countr_zero(m)].push_back(i);
         }
+    }
+    return passes;
+}
 
-        if (behavior == "jump_on_ground") {
+void BehaveSystem(EntityManager &em, float dt) {
+    for (BehaveBatches &pass : CollectBehaves(em, false)) {
+        for (int b = 0; b < BEH_COUNT; ++b) {
+            if (Behaves[b].update && !pass.rows[b].empty())
+                Behaves[b].update(em, pass.rows[b], dt * pass.rate);
         }
+    }
+}
 
-        if (behavior == "chase_player") {
+void BehaveDrawing(EntityManager &em) {
+    for (BehaveBatches &pass : CollectBehaves(em, true)) {
+        for (int b = 0; b < BEH_COUNT; ++b) {
+            if (Behaves[b].draw && !pass.rows[b].empty())
+                Behaves[b].draw(em, pass.rows[b]);
         }
     }
 }
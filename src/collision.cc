@@ -1,74 +1,120 @@
 #include "include/collision.h"
+#include "include/tiles.h"
 #include <algorithm>
+#include <bit>
+#include <climits>
 #include <cmath>
+#include <cstdint>
+#include <random>
 #include <raylib.h>
+#include <tuple>
 #include <vector>
 
-inline int CollisionSystem::GetGridIndex(float x, float y) {
-    if (std::isnan(x) || std::isnan(y))
+int CollisionSystem::ChunkOf(float w) {
+    if (std::isnan(w))
         return 0;
 
-    [[maybe_unused]] int gx = std::clamp(
-        static_cast<int>(x / static_cast<float>(CELL_SIZE)), 0, COLS - 1);
-    [[maybe_unused]] int gy = std::clamp(
-        static_cast<int>(y / static_cast<float>(CELL_SIZE)), 0, ROWS - 1);
+    // Floored so negatives land in the chunk to their left, and clamped so a
+    // runaway body can't overflow the cast
+    float c = std::floor(w / CHUNK_SIZE);
+    return static_cast<int>(std::clamp(c, -1e9f, 1e9f));
+}
 
-    if (x == 0)
-        gx = 0;
-    if (x == COLS * CELL_SIZE)
-        gx = COLS - 1;
+void CollisionSystem::Insert(int slot, int cx, int cy, uint32_t layer) {
+    GridChunk &chunk = chunks[ChunkKey(cx, cy)];
+    if (chunk.slots.empty() && chunk.slots.capacity() > 0)
+        --emptyChunks; // Revived before the sweep got to it
+    nodes[slot] = {&chunk, cx, cy, (int)chunk.slots.size(), layer};
+    chunk.slots.push_back(slot);
 
-    return (gy * COLS) + gx;
+    chunk.layers |= layer;
+    for (uint32_t bits = layer; bits; bits &= bits - 1)
+        chunk.layerCount[std::countr_zero(bits)]++;
 }
 
-void CollisionSystem::ResetTileGrid() { tileGridInitialized = false; }
-
-void CollisionSystem::BuildGrid(EntityManager &em) {
-    for (int i = 0; i < COLS * ROWS; ++i) {
-        tileGrid[i].clear();
-        grid[i].clear();
+void CollisionSystem::Erase(int slot) {
+    GridNode &node = nodes[slot];
+    std::vector<int> &list = node.chunk->slots;
+    int at = node.at;
+    list[at] = list.back();
+    nodes[list[at]].at = at;
+    list.pop_back();
+
+    GridChunk &chunk = *node.chunk;
+    for (uint32_t bits = node.layer; bits; bits &= bits - 1) {
+        int b = std::countr_zero(bits);
+        if (--chunk.layerCount[b] == 0)
+            chunk.layers &= ~(1u << b);
     }
 
-    for (size_t i = 0; i < em.physics.pos.size(); ++i) {
-        if (!em.physics.active[i])
-            continue;
+    if (list.empty())
+        ++emptyChunks;
+    node.chunk = nullptr;
+}
 
-        if (em.rendering.typeID[i] == EntityTys::TYTILE) {
-            int idx = GetGridIndex(em.physics.pos[i].x, em.physics.pos[i].y);
-            tileGrid[idx].push_back(i);
-        }
+void CollisionSystem::SweepChunks() {
+    // Emptied chunks are kept around so bodies hovering on a chunk border
+    // don't allocate on every crossing; drop them in bulk once they pile up
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        if (it->second.slots.empty())
+            it = chunks.erase(it);
+        else
+            ++it;
     }
+    emptyChunks = 0;
+}
 
-    for (size_t i = 0; i < em.physics.pos.size(); ++i) {
-        if (!em.physics.active[i] ||
-            em.rendering.typeID[i] == EntityTys::TYTILE)
-            continue;
+void CollisionSystem::UpdateGrid(EntityManager &em) {
+    size_t slots = em.sparse.size();
+    if (nodes.size() < slots)
+        nodes.resize(slots);
 
-        float centerX = em.physics.pos[i].x + (em.physics.siz[i].x * 0.5f);
-        float centerY = em.physics.pos[i].y + (em.physics.siz[i].y * 0.5f);
-        grid[GetGridIndex(centerX, centerY)].push_back(i);
+    // Freed slots drop out first; a slot reused since then is just moved
+    // below like any other
+    for (size_t slot = 0; slot < slots; ++slot) {
+        if (nodes[slot].chunk && em.sparse[slot] == EntityManager::InvalidSlot)
+            Erase((int)slot);
     }
+
+    // Then live entities in row order, filing them again only on a change.
+    // Sleepers and dormant rows haven't moved, and a layer change wakes
+    // them first.
+    auto awake = [&](size_t w) { return em.AwakeWord(w); };
+    ForEachBit(em.physics.active.WordCount(), awake, [&](size_t i) {
+        int slot = (int)em.dense[i];
+        int cx = ChunkOf(em.physics.pos[i].x + (em.physics.siz[i].x * 0.5f));
+        int cy = ChunkOf(em.physics.pos[i].y + (em.physics.siz[i].y * 0.5f));
+        uint32_t layer = em.physics.layer[i];
+
+        GridNode &node = nodes[slot];
+        if (node.chunk && node.cx == cx && node.cy == cy && node.layer == layer)
+            return;
+        if (node.chunk)
+            Erase(slot);
+        Insert(slot, cx, cy, layer);
+    });
+
+    if (emptyChunks > 64 && emptyChunks > chunks.size() / 2)
+        SweepChunks();
 }
 
 void CollisionSystem::ResolveAll(EntityManager &em, float dt) {
     if (dt <= 0.0f)
         return;
 
-    BuildGrid(em);
+    UpdateGrid(em);
 
-    for (int cellIdx = 0; cellIdx < COLS * ROWS; ++cellIdx) {
-        if (grid[cellIdx].empty())
-            continue;
-
-        for (size_t i : grid[cellIdx]) {
-            this->ResolveCollision(em, i);
-        }
-    }
+    // Each entity resolves against the tilemap alone, so row order gives the
+    // same result as cell order without hopping around the columns. Sleepers
+    // already rest clear of the tiles.
+    auto awake = [&](size_t w) { return em.AwakeWord(w); };
+    ForEachBit(em.physics.active.WordCount(), awake,
+               [&](size_t i) { this->ResolveCollision(em, i); });
 }
 
 void CollisionSystem::ResolveCollision(EntityManager &em, size_t i) {
-    em.physics.grounded[i] = false;
-    em.physics.walled[i] = false;
+    em.physics.grounded.set(i, false);
+    em.physics.walled.set(i, false);
 
     em.SyncRect(em, i);
     ResolveAxis(em, i, true);
@@ -77,97 +123,235 @@ void CollisionSystem::ResolveCollision(EntityManager &em, size_t i) {
     ResolveAxis(em, i, false);
 }
 
-// TODO: Fix sliding resolution
+// The part of a merged collider under the cells a probe covers. Pushing out
+// of that instead of the whole rect keeps a deep overlap from throwing the
+// body to the far end of a long run, exactly as with one tile per cell.
+static Rectangle ClipToCells(const Rectangle &r, const Rectangle &probe) {
+    const float ts = TileMap::TILE_SIZE;
+    float x0 = std::max(r.x, TileMap::CellOf(probe.x) * ts);
+    float y0 = std::max(r.y, TileMap::CellOf(probe.y) * ts);
+    float x1 = std::min(r.x + r.width,
+                        (TileMap::CellOf(probe.x + probe.width) + 1) * ts);
+    float y1 = std::min(r.y + r.height,
+                        (TileMap::CellOf(probe.y + probe.height) + 1) * ts);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
 void CollisionSystem::ResolveAxis(EntityManager &em, size_t i, bool isXAxis) {
     Vector2 &pos = em.physics.pos[i];
     Vector2 &vel = em.physics.vel[i];
     Vector2 &siz = em.physics.siz[i];
 
+    if (!em.physics.collide[i])
+        return;
+
     em.SyncRect(em, i);
     Rectangle sensor = isXAxis ? em.physics.rectX[i] : em.physics.rectY[i];
 
-    int startX = std::clamp((int)floorf(sensor.x / CELL_SIZE), 0, COLS - 1);
-    int startY = std::clamp((int)floorf(sensor.y / CELL_SIZE), 0, ROWS - 1);
-    int endX = std::clamp((int)floorf((sensor.x + sensor.width) / CELL_SIZE), 0,
-                          COLS - 1);
-    int endY = std::clamp((int)floorf((sensor.y + sensor.height) / CELL_SIZE),
-                          0, ROWS - 1);
-
     const float slidingFactor = 0.7f;
     const float velocityThreshold = 0.05f;
+    const uint32_t mask = em.physics.mask[i];
+
+    // Merged colliders have no internal seams to catch on when sliding
+    // along a run of tiles
+    tmap.ForEachCollider(sensor, [&](const TileCollider &c) {
+        if (!(c.layer & mask))
+            return;
+        Rectangle rJ = ClipToCells(c.rect, sensor);
+        if (!CheckCollisionRecs(sensor, rJ))
+            return; // Already pushed clear by an earlier collider
+
+        if (isXAxis) {
+            if (vel.x > 0) {
+                pos.x = rJ.x - siz.x;
+            } else if (vel.x < 0) {
+                pos.x = rJ.x + rJ.width;
+            }
+
+            if (std::abs(vel.x) < velocityThreshold)
+                vel.x = 0;
+
+            em.physics.walled.set(i, true);
+        } else {
+            if (vel.y > 0) {
+                pos.y = rJ.y - siz.y;
+                em.physics.grounded.set(i, true);
+            } else if (vel.y < 0) {
+                pos.y = rJ.y + rJ.height;
+                vel.y = 0;
+            }
+
+            vel.y *= slidingFactor;
+            if (std::abs(vel.y) < velocityThreshold)
+                vel.y = 0;
+        }
+
+        em.SyncRect(em, i);
+        sensor = isXAxis ? em.physics.rectX[i] : em.physics.rectY[i];
+    });
+}
+
+float CollisionSystem::TimeOfImpact(Rectangle box, Vector2 delta,
+                                    uint32_t mask, Rectangle &hit,
+                                    bool &hitX) const {
+    Rectangle broad = {std::min(box.x, box.x + delta.x),
+                       std::min(box.y, box.y + delta.y),
+                       box.width + std::abs(delta.x),
+                       box.height + std::abs(delta.y)};
+
+    // Per axis, the fraction of delta at which the box starts and stops
+    // overlapping the collider; the hit is where both overlaps have begun
+    auto axis = [](float a, float aSize, float b, float bSize, float d,
+                   float &entry, float &exit) {
+        if (d > 0.0f) {
+            entry = (b - (a + aSize)) / d;
+            exit = (b + bSize - a) / d;
+        } else if (d < 0.0f) {
+            entry = (b + bSize - a) / d;
+            exit = (b - (a + aSize)) / d;
+        } else if (a < b + bSize && a + aSize > b) {
+            entry = -INFINITY;
+            exit = INFINITY;
+        } else {
+            return false; // Not moving on this axis and not lined up
+        }
+        return true;
+    };
+
+    float best = 1.0f;
+    tmap.ForEachCollider(broad, [&](const TileCollider &c) {
+        const Rectangle &r = c.rect;
+        float xEntry, xExit, yEntry, yExit;
+        if (!(c.layer & mask) ||
+            !axis(box.x, box.width, r.x, r.width, delta.x, xEntry, xExit) ||
+            !axis(box.y, box.height, r.y, r.height, delta.y, yEntry, yExit))
+            return;
+
+        // Already overlapping is left to ResolveAxis
+        float entry = std::max(xEntry, yEntry);
+        float exit = std::min(xExit, yExit);
+        if (entry >= exit || entry < 0.0f || entry >= best)
+            return;
+
+        best = entry;
+        hit = r;
+        hitX = xEntry > yEntry;
+    });
+    return best;
+}
+
+void CollisionSystem::SweptMove(EntityManager &em, size_t i, Vector2 delta) {
+    Vector2 &pos = em.physics.pos[i];
+    Vector2 &vel = em.physics.vel[i];
+    Vector2 &siz = em.physics.siz[i];
+
+    const float slidingFactor = 0.7f;
 
-    for (int y = startY; y <= endY; ++y) {
-        for (int x = startX; x <= endX; ++x) {
-            for (size_t j : tileGrid[y * COLS + x]) {
-                if (i == j || em.rendering.typeID[j] != EntityTys::TYTILE)
-                    continue;
-                if (!em.physics.collide[i] || !em.physics.collide[j])
-                    continue;
-
-                Rectangle rJ = em.physics.rect[j];
-
-                if (CheckCollisionRecs(sensor, rJ)) {
-                    if (isXAxis) {
-                        if (vel.x > 0) {
-                            pos.x = rJ.x - siz.x;
-                        } else if (vel.x < 0) {
-                            pos.x = rJ.x + rJ.width;
-                        }
-
-                        if (std::abs(vel.x) < velocityThreshold)
-                            vel.x = 0;
-
-                        em.physics.walled[i] = true;
-                    } else {
-                        if (vel.y > 0) {
-                            pos.y = rJ.y - siz.y;
-                            em.physics.grounded[i] = true;
-                        } else if (vel.y < 0) {
-                            pos.y = rJ.y + rJ.height;
-                            vel.y = 0;
-                        }
-
-                        vel.y *= slidingFactor;
-                        if (std::abs(vel.y) < velocityThreshold)
-                            vel.y = 0;
-                    }
-
-                    em.SyncRect(em, i);
-                    sensor =
-                        isXAxis ? em.physics.rectX[i] : em.physics.rectY[i];
-                }
+    // A hit uses up the blocked axis; slide with the rest, at most a corner
+    // and a wall per tick
+    for (int pass = 0; pass < 3 && (delta.x != 0.0f || delta.y != 0.0f);
+         ++pass) {
+        Rectangle hit;
+        bool hitX = false;
+        float t = TimeOfImpact({pos.x, pos.y, siz.x, siz.y}, delta,
+                               em.physics.mask[i], hit, hitX);
+        if (t >= 1.0f) {
+            pos.x += delta.x;
+            pos.y += delta.y;
+            break;
+        }
+
+        // Snap flush to the face so the probes see contact, not overlap
+        if (hitX) {
+            pos.x = delta.x > 0 ? hit.x - siz.x : hit.x + hit.width;
+            pos.y += delta.y * t;
+            delta = {0.0f, delta.y * (1.0f - t)};
+            em.physics.walled.set(i, true);
+        } else {
+            pos.y = delta.y > 0 ? hit.y - siz.y : hit.y + hit.height;
+            pos.x += delta.x * t;
+            if (delta.y > 0) {
+                em.physics.grounded.set(i, true);
+                vel.y *= slidingFactor;
+            } else {
+                vel.y = 0;
             }
+            delta = {delta.x * (1.0f - t), 0.0f};
         }
     }
+
+    em.SyncRect(em, i);
+}
+
+size_t CollisionSystem::StressSweep(int bodies, float maxSpeed,
+                                    float tickRate) {
+    em.Clear();
+    tmap.Clear();
+
+    constexpr int Inner = 64; // Open cells per side
+    for (int c = -1; c <= Inner; ++c) {
+        tmap.Set(c, -1, EntityTys::TYTILE);
+        tmap.Set(c, Inner, EntityTys::TYTILE);
+        tmap.Set(-1, c, EntityTys::TYTILE);
+        tmap.Set(Inner, c, EntityTys::TYTILE);
+    }
+    tmap.BakeColliders();
+    const float ts = TileMap::TILE_SIZE, inner = Inner * ts;
+
+    // Fixed seed so a failure reproduces
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Vector2> spawns(bodies), vels(bodies);
+    for (int k = 0; k < bodies; ++k) {
+        spawns[k] = {unit(rng) * (inner - ts), unit(rng) * (inner - ts)};
+        const float a = unit(rng) * 2.0f * PI, v = unit(rng) * maxSpeed;
+        vels[k] = {std::cos(a) * v, std::sin(a) * v};
+    }
+    std::vector<size_t> rows;
+    if (!em.SpawnBatch(EntityTys::TYWALKER, spawns, &rows)) {
+        TraceLog(LOG_ERROR, "StressSweep: could not spawn WALKER");
+        tmap.Clear();
+        return SIZE_MAX;
+    }
+    for (size_t i : rows) {
+        em.physics.gravity[i] = 0.0f;
+        em.behs[i].mask = 0;
+    }
+
+    // Nothing is removed, so rows stay put. Every body gets its velocity
+    // back each tick and keeps pushing at whatever stopped it.
+    std::vector<bool> escaped(bodies, false);
+    const float dt = 1.0f / tickRate;
+    const int ticks = static_cast<int>(tickRate * 2.0f);
+    for (int t = 0; t < ticks; ++t) {
+        for (int k = 0; k < bodies; ++k)
+            em.physics.vel[rows[k]] = vels[k];
+        em.UpdateAll(dt);
+        ResolveAll(em, dt);
+        for (int k = 0; k < bodies; ++k) {
+            const Vector2 &p = em.physics.pos[rows[k]];
+            const Vector2 &s = em.physics.siz[rows[k]];
+            if (p.x < 0 || p.y < 0 || p.x + s.x > inner || p.y + s.y > inner)
+                escaped[k] = true;
+        }
+    }
+
+    em.Clear();
+    tmap.Clear();
+    return std::count(escaped.begin(), escaped.end(), true);
 }
 
 CollisionResult
 CollisionSystem::CheckCollisionsInternal(EntityManager &em, size_t i,
                                          const Rectangle &sensorRect) {
-    const float invCell = 1.0f / CELL_SIZE;
-    int startX = std::max(0, (int)(sensorRect.x * invCell));
-    int startY = std::max(0, (int)(sensorRect.y * invCell));
-    int endX =
-        std::min(COLS - 1, (int)((sensorRect.x + sensorRect.width) * invCell));
-    int endY =
-        std::min(ROWS - 1, (int)((sensorRect.y + sensorRect.height) * invCell));
-
-    for (int y = startY; y <= endY; ++y) {
-        int rowOffset = y * COLS;
-        for (int x = startX; x <= endX; ++x) {
-            const auto &cell = tileGrid[rowOffset + x];
-            for (size_t j : cell) {
-                if (i == j)
-                    continue;
-
-                if (CheckCollisionRecs(sensorRect, em.physics.rect[j])) {
-                    return {true, em.rendering.typeID[j], em.physics.pos[j],
-                            em.physics.siz[j]};
-                }
-            }
-        }
-    }
-    return {false, 0, {0, 0}, {0, 0}};
+    CollisionResult res = {false, 0, 0, {0, 0}, {0, 0}};
+    const uint32_t mask = em.physics.mask[i];
+    tmap.ForEachCollider(sensorRect, [&](const TileCollider &c) {
+        if (!res.hit && (c.layer & mask))
+            res = {true, c.type, c.layer, {c.rect.x, c.rect.y},
+                   {c.rect.width, c.rect.height}};
+    });
+    return res;
 }
 
 CollisionResult CollisionSystem::CheckCollisions(EntityManager &em,
@@ -184,6 +368,496 @@ CollisionResult CollisionSystem::CheckCollisionsY(EntityManager &em, size_t i) {
     return CheckCollisionsInternal(em, i, em.physics.rectY[i]);
 }
 
+// --- Spatial queries ---
+
+// QueryFilter::Accepts with the last type answer kept; rows and tiles of one
+// type tend to come in runs, and the type lookup is a hash
+struct TypeCheck {
+    const QueryFilter &filter;
+    int lastType = INT_MIN;
+    bool last = false;
+
+    bool operator()(int typeID, uint32_t layer) {
+        if (!filter.OnLayer(layer))
+            return false;
+        if (typeID != lastType) {
+            lastType = typeID;
+            last = filter.Accepts(typeID);
+        }
+        return last;
+    }
+};
+
+static bool CircleOverlaps(Vector2 c, float radius, const Rectangle &r) {
+    float nx = std::clamp(c.x, r.x, r.x + r.width);
+    float ny = std::clamp(c.y, r.y, r.y + r.height);
+    float dx = c.x - nx, dy = c.y - ny;
+    return dx * dx + dy * dy < radius * radius;
+}
+
+// Where the segment from + d * t, t in [0, 1], enters r. Starting inside
+// counts as t = 0 with no normal.
+static bool SegmentRect(Vector2 from, Vector2 d, const Rectangle &r, float &t,
+                        Vector2 &normal) {
+    float tMin = 0.0f, tMax = 1.0f;
+    normal = {0, 0};
+
+    if (d.x != 0.0f) {
+        float t1 = (r.x - from.x) / d.x;
+        float t2 = (r.x + r.width - from.x) / d.x;
+        if (t1 > t2)
+            std::swap(t1, t2);
+        if (t1 > tMin) {
+            tMin = t1;
+            normal = {d.x > 0 ? -1.0f : 1.0f, 0};
+        }
+        tMax = std::min(tMax, t2);
+    } else if (from.x < r.x || from.x > r.x + r.width) {
+        return false;
+    }
+
+    if (d.y != 0.0f) {
+        float t1 = (r.y - from.y) / d.y;
+        float t2 = (r.y + r.height - from.y) / d.y;
+        if (t1 > t2)
+            std::swap(t1, t2);
+        if (t1 > tMin) {
+            tMin = t1;
+            normal = {0, d.y > 0 ? -1.0f : 1.0f};
+        }
+        tMax = std::min(tMax, t2);
+    } else if (from.y < r.y || from.y > r.y + r.height) {
+        return false;
+    }
+
+    if (tMin > tMax)
+        return false;
+    t = tMin;
+    return true;
+}
+
+template <typename F>
+void CollisionSystem::ForEachFiled(const EntityManager &em, Rectangle area,
+                                   uint32_t layers, F f) const {
+    int cx0 = ChunkOf(area.x - QueryMargin);
+    int cx1 = ChunkOf(area.x + area.width + QueryMargin);
+    int cy0 = ChunkOf(area.y - QueryMargin);
+    int cy1 = ChunkOf(area.y + area.height + QueryMargin);
+
+    // An area spanning more chunks than exist is cheaper to answer from the
+    // occupied ones
+    bool scanAll = (int64_t)(cx1 - cx0 + 1) * (cy1 - cy0 + 1) >
+                   (int64_t)chunks.size();
+    // ~0u also wants entities on no layer at all, which no chunk bit covers
+    bool anyLayer = layers == ~0u;
+
+    for (int cy = cy0; cy <= cy1 && !scanAll; ++cy) {
+        for (int cx = cx0; cx <= cx1; ++cx) {
+            auto it = chunks.find(ChunkKey(cx, cy));
+            if (it == chunks.end() ||
+                (!anyLayer && !(it->second.layers & layers)))
+                continue;
+            for (int slot : it->second.slots) {
+                uint32_t i = em.sparse[slot];
+                if (i != EntityManager::InvalidSlot)
+                    f((size_t)i);
+            }
+        }
+    }
+
+    if (!scanAll)
+        return;
+    for (auto const &[key, chunk] : chunks) {
+        int cx = (int)(int32_t)(uint32_t)(key >> 32);
+        int cy = (int)(int32_t)(uint32_t)key;
+        if (cx < cx0 || cx > cx1 || cy < cy0 || cy > cy1 ||
+            (!anyLayer && !(chunk.layers & layers)))
+            continue;
+        for (int slot : chunk.slots) {
+            uint32_t i = em.sparse[slot];
+            if (i != EntityManager::InvalidSlot)
+                f((size_t)i);
+        }
+    }
+}
+
+template <typename Test>
+size_t CollisionSystem::Collect(const EntityManager &em, Rectangle bounds,
+                                const QueryFilter &filter,
+                                std::span<QueryHit> out, Test test) const {
+    size_t n = 0;
+    if (filter.tiles) {
+        TypeCheck accepts{filter};
+        tmap.ForEachCollider(bounds, [&](const TileCollider &c) {
+            if (n < out.size() && accepts(c.type, c.layer) && test(c.rect))
+                out[n++] = {EntityManager::InvalidIndex, c.type, c.rect};
+        });
+    }
+    if (filter.entities) {
+        TypeCheck accepts{filter};
+        ForEachFiled(em, bounds, filter.layers, [&](size_t i) {
+            const Rectangle &r = em.physics.rect[i];
+            if (n < out.size() && i != filter.ignore &&
+                accepts(em.rendering.typeID[i], em.physics.layer[i]) && test(r))
+                out[n++] = {i, em.rendering.typeID[i], r};
+        });
+    }
+    return n;
+}
+
+void CollisionSystem::WakeArea(EntityManager &em, Rectangle area) {
+    // Grown by a cell so bodies standing on or leaning against its edge
+    // count too
+    const float ts = TileMap::TILE_SIZE;
+    Rectangle grown = {area.x - ts, area.y - ts, area.width + ts * 2.0f,
+                       area.height + ts * 2.0f};
+    ForEachFiled(em, grown, ~0u, [&](size_t i) {
+        if (em.physics.sleeping[i] &&
+            TileMap::Overlaps(grown, em.physics.rect[i]))
+            em.Wake(i);
+    });
+}
+
+size_t CollisionSystem::QueryAABB(const EntityManager &em, Rectangle area,
+                                  const QueryFilter &filter,
+                                  std::span<QueryHit> out) const {
+    return Collect(em, area, filter, out, [&](const Rectangle &r) {
+        return TileMap::Overlaps(area, r);
+    });
+}
+
+size_t CollisionSystem::QueryRadius(const EntityManager &em, Vector2 center,
+                                    float radius, const QueryFilter &filter,
+                                    std::span<QueryHit> out) const {
+    Rectangle bounds = {center.x - radius, center.y - radius, radius * 2.0f,
+                        radius * 2.0f};
+    return Collect(em, bounds, filter, out, [&](const Rectangle &r) {
+        return CircleOverlaps(center, radius, r);
+    });
+}
+
+bool CollisionSystem::Raycast(const EntityManager &em, Vector2 from,
+                              Vector2 to, const QueryFilter &filter,
+                              RayHit &hit) const {
+    Vector2 d = {to.x - from.x, to.y - from.y};
+    RayHit best;
+    bool found = false;
+
+    if (filter.tiles) {
+        TypeCheck accepts{filter};
+        tmap.TraceSegment(from, to, [&](const TileCollider &c) {
+            float t;
+            Vector2 normal;
+            if (!accepts(c.type, c.layer) ||
+                !SegmentRect(from, d, c.rect, t, normal))
+                return true;
+            // Colliders arrive in ray order, so the first one is nearest
+            best = {{EntityManager::InvalidIndex, c.type, c.rect}, t, {},
+                    normal};
+            found = true;
+            return false;
+        });
+    }
+
+    if (filter.entities) {
+        // Nothing past the tile hit can win, so only search up to it
+        Vector2 end = {from.x + d.x * best.t, from.y + d.y * best.t};
+        Rectangle bounds = {std::min(from.x, end.x), std::min(from.y, end.y),
+                            std::abs(end.x - from.x), std::abs(end.y - from.y)};
+        TypeCheck accepts{filter};
+        ForEachFiled(em, bounds, filter.layers, [&](size_t i) {
+            float t;
+            Vector2 normal;
+            if (i == filter.ignore ||
+                !accepts(em.rendering.typeID[i], em.physics.layer[i]) ||
+                !SegmentRect(from, d, em.physics.rect[i], t, normal) ||
+                (found && t >= best.t))
+                return;
+            best = {{i, em.rendering.typeID[i], em.physics.rect[i]}, t, {},
+                    normal};
+            found = true;
+        });
+    }
+
+    if (!found)
+        return false;
+    best.point = {from.x + d.x * best.t, from.y + d.y * best.t};
+    hit = best;
+    return true;
+}
+
+size_t CollisionSystem::RaycastAll(const EntityManager &em, Vector2 from,
+                                   Vector2 to, const QueryFilter &filter,
+                                   std::span<RayHit> out) const {
+    if (out.empty())
+        return 0;
+
+    Vector2 d = {to.x - from.x, to.y - from.y};
+    auto nearer = [](const RayHit &a, const RayHit &b) { return a.t < b.t; };
+
+    // Keep the nearest out.size(): once full, a hit only gets in by
+    // replacing the farthest one held
+    size_t n = 0;
+    auto add = [&](const QueryHit &q, float t, Vector2 normal) {
+        RayHit h = {q, t, {from.x + d.x * t, from.y + d.y * t}, normal};
+        if (n < out.size()) {
+            out[n++] = h;
+            return;
+        }
+        auto farthest = std::max_element(out.begin(), out.end(), nearer);
+        if (t < farthest->t)
+            *farthest = h;
+    };
+
+    if (filter.tiles) {
+        TypeCheck accepts{filter};
+        tmap.TraceSegment(from, to, [&](const TileCollider &c) {
+            float t;
+            Vector2 normal;
+            if (accepts(c.type, c.layer) &&
+                SegmentRect(from, d, c.rect, t, normal))
+                add({EntityManager::InvalidIndex, c.type, c.rect}, t, normal);
+            return true;
+        });
+    }
+
+    if (filter.entities) {
+        Rectangle bounds = {std::min(from.x, to.x), std::min(from.y, to.y),
+                            std::abs(d.x), std::abs(d.y)};
+        TypeCheck accepts{filter};
+        ForEachFiled(em, bounds, filter.layers, [&](size_t i) {
+            float t;
+            Vector2 normal;
+            if (i != filter.ignore &&
+                accepts(em.rendering.typeID[i], em.physics.layer[i]) &&
+                SegmentRect(from, d, em.physics.rect[i], t, normal))
+                add({i, em.rendering.typeID[i], em.physics.rect[i]}, t,
+                    normal);
+        });
+    }
+
+    std::sort(out.begin(), out.begin() + n, nearer);
+    return n;
+}
+
+// --- Contacts ---
+
+void CollisionSystem::GatherContactBodies(EntityManager &em) {
+    for (ContactGroup &g : contactGroups) {
+        g.bodies.clear();
+        g.masks = 0;
+        g.maxWidth = g.maxHeight = 0.0f;
+    }
+
+    // Bodies of one layer tend to come in runs of rows, so the group found
+    // last is tried first. Dormant rows are out of the simulation.
+    ContactGroup *g = nullptr;
+    auto live = [&](size_t w) {
+        return em.physics.active.words[w] & ~em.physics.dormant.words[w];
+    };
+    ForEachBit(em.physics.active.WordCount(), live, [&](size_t i) {
+        uint32_t layer = em.physics.layer[i], mask = em.physics.mask[i];
+        if (layer == 0 || mask == 0 || em.stats.health[i] <= 0.0f)
+            return;
+
+        if (!g || g->layer != layer) {
+            auto it = std::find_if(
+                contactGroups.begin(), contactGroups.end(),
+                [&](const ContactGroup &c) { return c.layer == layer; });
+            if (it == contactGroups.end()) {
+                contactGroups.push_back({});
+                it = contactGroups.end() - 1;
+                it->layer = layer;
+            }
+            g = &*it;
+        }
+
+        const Rectangle &r = em.physics.rect[i];
+        g->bodies.push_back(
+            {r.x, r.x + r.width, r.y, r.y + r.height, em.dense[i], mask});
+        g->masks |= mask;
+        g->maxWidth = std::max(g->maxWidth, r.width);
+        g->maxHeight = std::max(g->maxHeight, r.height);
+    });
+}
+
+void CollisionSystem::FileContactGrid(const ContactGroup &g) {
+    ContactGrid &grid = contactGrid;
+
+    // Bodies are filed by their top-left corner in cells at least as big as
+    // the largest of them, so a probe only has to reach one cell back
+    float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+    for (const ContactBody &b : g.bodies) {
+        x0 = std::min(x0, b.x0);
+        y0 = std::min(y0, b.y0);
+        x1 = std::max(x1, b.x0);
+        y1 = std::max(y1, b.y0);
+    }
+    float cell = std::max({g.maxWidth, g.maxHeight, 16.0f});
+    // A few bodies spread far apart must not make a huge table
+    size_t limit = g.bodies.size() * 2 + 16;
+    while (((x1 - x0) / cell + 1.0f) * ((y1 - y0) / cell + 1.0f) >
+           (float)limit)
+        cell *= 2.0f;
+
+    // Probes scale by the same reciprocal, so both round alike at borders
+    float inv = 1.0f / cell;
+    grid.x = x0;
+    grid.y = y0;
+    grid.cell = cell;
+    grid.w = (int)((x1 - x0) * inv) + 1;
+    grid.h = (int)((y1 - y0) * inv) + 1;
+
+    // Counting sort into cells
+    auto cellOf = [&](const ContactBody &b) {
+        return (int)((b.y0 - y0) * inv) * grid.w + (int)((b.x0 - x0) * inv);
+    };
+    grid.start.assign((size_t)grid.w * grid.h + 1, 0);
+    for (const ContactBody &b : g.bodies)
+        ++grid.start[cellOf(b) + 1];
+    for (size_t c = 1; c < grid.start.size(); ++c)
+        grid.start[c] += grid.start[c - 1];
+
+    grid.bodies.resize(g.bodies.size());
+    for (const ContactBody &b : g.bodies) {
+        // start[c] walks up to start[c + 1] while filling, then is put back
+        grid.bodies[grid.start[cellOf(b)]++] = b;
+    }
+    for (size_t c = grid.start.size() - 1; c > 0; --c)
+        grid.start[c] = grid.start[c - 1];
+    grid.start[0] = 0;
+}
+
+void CollisionSystem::AddPair(const EntityManager &em, uint32_t a,
+                              uint32_t b) {
+    if (a > b)
+        std::swap(a, b);
+    pairs.push_back({{a, em.generations[a]}, {b, em.generations[b]}});
+}
+
+void CollisionSystem::PairGroups(const EntityManager &em, ContactGroup &g,
+                                 ContactGroup &h) {
+    auto touch = [&](const ContactBody &p, uint32_t pLayer,
+                     const ContactBody &q, uint32_t qLayer) {
+        if ((p.mask & qLayer) && (q.mask & pLayer) && p.y0 < q.y1 &&
+            p.y1 > q.y0 && p.x0 < q.x1 && p.x1 > q.x0)
+            AddPair(em, p.slot, q.slot);
+    };
+
+    if (&g == &h) {
+        // A layer that touches itself: sort and sweep
+        std::vector<ContactBody> &b = g.bodies;
+        std::sort(b.begin(), b.end(),
+                  [](const ContactBody &l, const ContactBody &r) {
+                      return l.x0 < r.x0;
+                  });
+        for (size_t i = 0; i < b.size(); ++i) {
+            for (size_t j = i + 1; j < b.size() && b[j].x0 < b[i].x1; ++j)
+                touch(b[i], g.layer, b[j], g.layer);
+        }
+        return;
+    }
+
+    ContactGroup &small = g.bodies.size() <= h.bodies.size() ? g : h;
+    ContactGroup &large = &small == &g ? h : g;
+    FileContactGrid(small);
+
+    const ContactGrid &grid = contactGrid;
+    float gx1 = grid.x + grid.w * grid.cell, gy1 = grid.y + grid.h * grid.cell;
+    float inv = 1.0f / grid.cell;
+    for (const ContactBody &p : large.bodies) {
+        // Anything that can reach p is filed between p's top-left corner
+        // less the largest body and its bottom-right corner
+        float px0 = p.x0 - small.maxWidth, py0 = p.y0 - small.maxHeight;
+        if (p.x1 < grid.x || p.y1 < grid.y || px0 >= gx1 || py0 >= gy1)
+            continue;
+
+        // Clamped as floats first; a far off body would overflow the cast
+        int cx0 = (int)(std::max(px0 - grid.x, 0.0f) * inv);
+        int cy0 = (int)(std::max(py0 - grid.y, 0.0f) * inv);
+        int cx1 = (int)std::min((p.x1 - grid.x) * inv, grid.w - 1.0f);
+        int cy1 = (int)std::min((p.y1 - grid.y) * inv, grid.h - 1.0f);
+        for (int cy = cy0; cy <= cy1; ++cy) {
+            const uint32_t *row = &grid.start[(size_t)cy * grid.w];
+            for (uint32_t k = row[cx0]; k < row[cx1 + 1]; ++k)
+                touch(p, large.layer, grid.bodies[k], small.layer);
+        }
+    }
+}
+
+void CollisionSystem::UpdateContacts(EntityManager &em) {
+    GatherContactBodies(em);
+
+    pairs.clear();
+    for (size_t g = 0; g < contactGroups.size(); ++g) {
+        for (size_t h = g; h < contactGroups.size(); ++h) {
+            ContactGroup &a = contactGroups[g], &b = contactGroups[h];
+            if (a.bodies.empty() || b.bodies.empty() ||
+                !(a.masks & b.layer) || !(b.masks & a.layer))
+                continue;
+            PairGroups(em, a, b);
+        }
+    }
+
+    // Live entities never share a slot, so the slot pair alone orders this
+    // tick's list; generations only matter when diffing against the last
+    auto key = [](const std::pair<EntityHandle, EntityHandle> &p) {
+        return ((uint64_t)p.first.index << 32) | p.second.index;
+    };
+    std::sort(pairs.begin(), pairs.end(),
+              [&](const auto &p, const auto &q) { return key(p) < key(q); });
+    auto less = [&](const std::pair<EntityHandle, EntityHandle> &p,
+                    const std::pair<EntityHandle, EntityHandle> &q) {
+        if (key(p) != key(q))
+            return key(p) < key(q);
+        return std::tie(p.first.generation, p.second.generation) <
+               std::tie(q.first.generation, q.second.generation);
+    };
+
+    // A dormant body isn't gathered, but it hasn't left anything it was
+    // touching either: those pairs carry on, unreported, until it's back
+    auto dormant = [&](EntityHandle h) {
+        size_t i = em.Resolve(h);
+        return i != EntityManager::InvalidIndex && em.physics.dormant[i];
+    };
+    auto alive = [&](EntityHandle h) {
+        return em.Resolve(h) != EntityManager::InvalidIndex;
+    };
+    heldPairs.clear();
+
+    // Both lists sorted, so one merge tells new, kept and lost pairs apart
+    contacts.clear();
+    size_t i = 0, j = 0;
+    while (i < pairs.size() || j < lastPairs.size()) {
+        if (j == lastPairs.size() ||
+            (i < pairs.size() && less(pairs[i], lastPairs[j]))) {
+            contacts.push_back({pairs[i].first, pairs[i].second,
+                                CONTACT_BEGIN});
+            ++i;
+        } else if (i == pairs.size() || less(lastPairs[j], pairs[i])) {
+            const auto &p = lastPairs[j];
+            if (alive(p.first) && alive(p.second) &&
+                (dormant(p.first) || dormant(p.second)))
+                heldPairs.push_back(p);
+            else
+                contacts.push_back({p.first, p.second, CONTACT_END});
+            ++j;
+        } else {
+            contacts.push_back({pairs[i].first, pairs[i].second,
+                                CONTACT_STAY});
+            ++i;
+            ++j;
+        }
+    }
+    if (!heldPairs.empty()) {
+        size_t mid = pairs.size();
+        pairs.insert(pairs.end(), heldPairs.begin(), heldPairs.end());
+        std::inplace_merge(pairs.begin(), pairs.begin() + mid, pairs.end(),
+                           less);
+    }
+    std::swap(pairs, lastPairs);
+}
+
 bool CollisionSystem::LineIntersectsRect(Vector2 a, Vector2 b, Rectangle r) {
     float minX = (a.x < b.x) ? a.x : b.x;
     float maxX = (a.x > b.x) ? a.x : b.x;
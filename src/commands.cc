@@ -0,0 +1,150 @@
+#include "include/commands.h"
+#include "include/data.h"
+#include "include/entities.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <raylib.h>
+#include <vector>
+
+namespace {
+std::mutex bufferMutex;
+std::vector<CommandBuffer *> buffers;
+std::vector<EntityCommand> orphaned; // Left behind by threads that exited
+std::atomic<uint64_t> nextOrder{0};
+
+struct ThreadBuffer {
+    CommandBuffer buffer;
+
+    ThreadBuffer() {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        buffers.push_back(&buffer);
+    }
+
+    ~ThreadBuffer() {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        orphaned.insert(orphaned.end(), buffer.commands.begin(),
+                        buffer.commands.end());
+        buffers.erase(std::remove(buffers.begin(), buffers.end(), &buffer),
+                      buffers.end());
+    }
+};
+} // namespace
+
+CommandBuffer &Commands() {
+    thread_local ThreadBuffer tb;
+    return tb.buffer;
+}
+
+EntityCommand &CommandBuffer::Record(CommandType type, EntityHandle h) {
+    EntityCommand &cmd = commands.emplace_back();
+    cmd.type = type;
+    cmd.order = nextOrder.fetch_add(1, std::memory_order_relaxed);
+    cmd.target = h;
+    return cmd;
+}
+
+void CommandBuffer::Spawn(int typeID, Vector2 pos) {
+    EntityCommand &cmd = Record(CMD_SPAWN, NullHandle);
+    cmd.typeID = typeID;
+    cmd.vec = pos;
+}
+
+void CommandBuffer::Destroy(EntityHandle h) { Record(CMD_DESTROY, h); }
+
+void CommandBuffer::SetPos(EntityHandle h, Vector2 pos) {
+    Record(CMD_SET_POS, h).vec = pos;
+}
+
+void CommandBuffer::SetVel(EntityHandle h, Vector2 vel) {
+    Record(CMD_SET_VEL, h).vec = vel;
+}
+
+void CommandBuffer::SetHealth(EntityHandle h, float health) {
+    Record(CMD_SET_HEALTH, h).value = health;
+}
+
+void FlushCommands(EntityManager &em) {
+    static std::vector<EntityCommand> pending;
+    static std::vector<size_t> doomed;
+    pending.clear();
+    doomed.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        pending.swap(orphaned);
+        for (CommandBuffer *b : buffers) {
+            pending.insert(pending.end(), b->commands.begin(),
+                           b->commands.end());
+            b->commands.clear();
+        }
+    }
+
+    if (pending.empty())
+        return;
+
+    std::sort(pending.begin(), pending.end(),
+              [](const EntityCommand &a, const EntityCommand &b) {
+                  return a.order < b.order;
+              });
+
+    // 1. Component writes, while every recorded handle still resolves
+    for (const EntityCommand &cmd : pending) {
+        size_t i = em.Resolve(cmd.target);
+        if (i == EntityManager::InvalidIndex)
+            continue;
+
+        switch (cmd.type) {
+        case CMD_DESTROY:
+            doomed.push_back(i);
+            break;
+        case CMD_SET_POS:
+            em.physics.pos[i] = cmd.vec;
+            em.physics.prevPos[i] = cmd.vec; // Teleport, don't interpolate
+            em.SyncRect(em, i);
+            em.Wake(i);
+            break;
+        case CMD_SET_VEL:
+            em.physics.vel[i] = cmd.vec;
+            em.Wake(i);
+            break;
+        case CMD_SET_HEALTH:
+            em.stats.health[i] = cmd.value;
+            em.Wake(i); // The step is what notices it died
+            break;
+        default:
+            break;
+        }
+    }
+
+    // 2. Removals, tombstoned; RemoveBatch compacts once enough pile up
+    em.RemoveBatch(doomed);
+
+    // 3. Spawns last so they can never be hit by a destroy this tick. Runs of
+    // the same type go through one SpawnBatch call.
+    static std::vector<Vector2> positions;
+    int runType = 0;
+    positions.clear();
+    auto spawnRun = [&]() {
+        if (!positions.empty())
+            em.SpawnBatch(runType, positions);
+        positions.clear();
+    };
+
+    for (const EntityCommand &cmd : pending) {
+        if (cmd.type != CMD_SPAWN)
+            continue;
+        if (cmd.typeID != runType)
+            spawnRun();
+        runType = cmd.typeID;
+        positions.push_back(cmd.vec);
+    }
+    spawnRun();
+}
+
+void DiscardCommands() {
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    orphaned.clear();
+    for (CommandBuffer *b : buffers)
+        b->commands.clear();
+}
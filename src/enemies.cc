@@ -2,6 +2,6 @@
 #include "include/entities.h"
 #include <cstddef>
 
-void EnemySystem(EntityManager &em, size_t i) {}
+void EnemySystem(EntityManager &em, size_t i, float /*dt*/) {}
 
 void EnemyDrawing(EntityManager &em, size_t i) {}
@@ -3,6 +3,7 @@
 #include "include/behaves.h"
 #include "include/character.h"
 #include "include/collision.h"
+#include "include/commands.h"
 #include "include/constants.h"
 #include "include/data.h"
 #include "include/enemies.h"
@@ -10,9 +11,15 @@
 #include "include/tiles.h"
 #include "raylib.h"
 #include "raymath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
 void EntityManager::Reserve(size_t capacity) {
     if (capacity > 1000000)
@@ -24,105 +31,219 @@ void EntityManager::Reserve(size_t capacity) {
 
     vars.reserve(capacity);
     behs.reserve(capacity);
+
+    sparse.reserve(capacity);
+    generations.reserve(capacity);
+    dense.reserve(capacity);
 }
 
-size_t EntityManager::AddEntity(int typeID, int varID, Vector2 pos, Vector2 siz,
-                                float gravity, Color col) {
-    physics.pos.push_back(pos);
-    physics.vel.push_back({0, 0});
-    physics.siz.push_back(siz);
-    physics.scale.push_back({1.0f, 1.0f});
-    physics.mass.push_back(1.0f);
-    physics.gravity.push_back(gravity);
-    physics.active.push_back(true);
-    physics.initialized.push_back(false);
-    physics.collide.push_back(true);
-    physics.grounded.push_back(false);
-    physics.walled.push_back(false);
-    physics.rect.push_back({pos.x, pos.y, siz.x, siz.y}); // Initialize rect
-    physics.rectX.push_back({0, 0, 0, 0});
-    physics.rectY.push_back({0, 0, 0, 0});
-
-    rendering.varID.push_back(varID);
-    rendering.typeID.push_back(typeID);
-    rendering.col.push_back(col);
-    rendering.rotation.push_back(0.0f);
-    rendering.texDraw.push_back(false);
-    rendering.frameNum.push_back(0);
-    rendering.rowIndex.push_back(0);
-    rendering.frameMin.push_back(0);
-    rendering.frameMax.push_back(0);
-    rendering.frameSpd.push_back(1.0f);
-
-    stats.health.push_back(100.0f);
-    stats.maxHealth.push_back(100.0f);
-
-    vars.push_back(EntityVars());
-    behs.push_back(EntityBehaves());
-
-    TraceLog(LOG_INFO, "ADDING ENTITY: [%s] Gravity: %.2f",
+EntityHandle EntityManager::AddEntity(int typeID, int varID, Vector2 pos,
+                                      Vector2 siz, float gravity, Color col) {
+    // Seed type defaults (vars, behaviors, layers); the explicit fields go on
+    // top and the level loader overwrites what it saved
+    EntityConfig cfg;
+    int t = GetDenseType(typeID);
+    if (t >= 0) {
+        if (const EntityConfig *typeCfg = typeConfigs[t]) {
+            cfg.varLayout = typeCfg->varLayout;
+            cfg.canCollide = typeCfg->canCollide;
+            cfg.layer = typeCfg->layer;
+            cfg.mask = typeCfg->mask;
+        }
+        cfg.behMask = typeBehaves[t];
+    }
+    cfg.tID = typeID;
+    cfg.vID = varID;
+    cfg.size = siz;
+    cfg.gravity = gravity;
+    cfg.color = col;
+
+    size_t index;
+    if (!SpawnRange(cfg, std::span<const Vector2>(&pos, 1),
+                    std::span<size_t>(&index, 1)))
+        return NullHandle; // Painted into the tilemap
+
+    TraceLog(LOG_DEBUG, "ADDING ENTITY: [%s] Gravity: %.2f",
              IdToName[typeID].c_str(), gravity);
-
-    return physics.pos.size() - 1;
+    return GetHandle(index);
 }
 
-size_t EntityManager::AddEntityJ(std::string typeName, Vector2 pos) {
+EntityHandle EntityManager::AddEntityJ(std::string typeName,
+                                       Vector2 pos) {
     auto it = ConfigMap.find(typeName);
     if (it == ConfigMap.end()) {
         TraceLog(LOG_ERROR, "Type [%s] not found!", typeName.c_str());
-        return 0;
+        return NullHandle;
+    }
+
+    size_t index;
+    if (!SpawnRange(it->second, std::span<const Vector2>(&pos, 1),
+                    std::span<size_t>(&index, 1)))
+        return NullHandle; // Painted into the tilemap
+
+    TraceLog(LOG_DEBUG, "ADDING ENTITY: [%s] Gravity: %.2f", typeName.c_str(),
+             it->second.gravity);
+    return GetHandle(index);
+}
+
+bool EntityManager::SpawnBatch(int typeID, std::span<const Vector2> positions,
+                               std::vector<size_t> *indices) {
+    int t = GetDenseType(typeID);
+    if (t < 0 || !typeConfigs[t]) {
+        TraceLog(LOG_ERROR, "Type %d not found!", typeID);
+        return false;
     }
 
-    EntityConfig &cfg = it->second;
+    std::span<size_t> out;
+    if (indices) {
+        indices->resize(positions.size());
+        out = *indices;
+    }
+
+    bool spawned = SpawnRange(*typeConfigs[t], positions, out);
+    TraceLog(LOG_INFO, "SPAWN: %zu x [%s]", positions.size(),
+             IdToName[typeID].c_str());
+    return spawned;
+}
+
+bool EntityManager::SpawnRange(const EntityConfig &cfg,
+                               std::span<const Vector2> positions,
+                               std::span<size_t> out) {
+    // Tile types are painted into the tilemap instead of becoming entities
+    if (IsTileType(cfg.tID)) {
+        for (const Vector2 &pos : positions) {
+            tmap.Set(TileMap::CellOf(pos.x + cfg.size.x * 0.5f),
+                     TileMap::CellOf(pos.y + cfg.size.y * 0.5f), cfg.tID,
+                     cfg.vID);
+        }
+        return false;
+    }
+
+    // Refill tombstoned rows first; nothing has to grow for those
+    size_t k = 0;
+    for (; k < positions.size() && !freeRows.empty(); ++k) {
+        size_t i = freeRows.back();
+        freeRows.pop_back();
+        WriteRow(i, cfg, positions[k]);
+        AllocHandle(i);
+        if (!out.empty())
+            out[k] = i;
+    }
+
+    positions = positions.subspan(k);
+    if (positions.empty())
+        return true;
+
+    // Then grow every column once for the rest
+    size_t first = physics.pos.size();
+    size_t n = positions.size();
+    size_t end = first + n;
 
     // --- PHYSICS (Must match PhysicsComponent struct exactly) ---
-    physics.pos.push_back(pos);
-    physics.vel.push_back({0, 0});
-    physics.siz.push_back(cfg.size);
-    physics.scale.push_back({1.0f, 1.0f});
-    physics.rect.push_back({pos.x, pos.y, cfg.size.x, cfg.size.y});
-    physics.rectX.push_back({0, 0, 0, 0});
-    physics.rectY.push_back({0, 0, 0, 0});
-    physics.mass.push_back(1.0f);
-    physics.gravity.push_back(cfg.gravity);
-    physics.active.push_back(true);
-    physics.initialized.push_back(false);
-    physics.collide.push_back(cfg.canCollide);
-    physics.grounded.push_back(false);
-    physics.walled.push_back(false);
+    physics.pos.insert(physics.pos.end(), positions.begin(), positions.end());
+    physics.prevPos.insert(physics.prevPos.end(), positions.begin(),
+                           positions.end());
+    physics.vel.resize(end, {0, 0});
+    physics.siz.resize(end, cfg.size);
+    physics.scale.resize(end, {1.0f, 1.0f});
+    physics.rect.resize(end);
+    for (size_t j = 0; j < n; ++j)
+        physics.rect[first + j] = {positions[j].x, positions[j].y, cfg.size.x,
+                                   cfg.size.y};
+    physics.rectX.resize(end, {0, 0, 0, 0});
+    physics.rectY.resize(end, {0, 0, 0, 0});
+    physics.mass.resize(end, 1.0f);
+    physics.gravity.resize(end, cfg.gravity);
+    physics.layer.resize(end, cfg.layer);
+    physics.mask.resize(end, cfg.mask);
+    physics.restTicks.resize(end, 0);
+    physics.active.append(n, true);
+    physics.initialized.append(n, false);
+    physics.collide.append(n, cfg.canCollide);
+    physics.grounded.append(n, false);
+    physics.walled.append(n, false);
+    physics.sleeping.append(n, false);
+    physics.dormant.append(n, false);
+    physics.reduced.append(n, false);
 
     // --- RENDERING (Must match RenderComponent struct exactly) ---
-    rendering.varID.push_back(cfg.vID);
-    rendering.typeID.push_back(cfg.tID);
-    rendering.col.push_back(cfg.color);
-
-    rendering.rotation.push_back(0.0f);
-    rendering.texDraw.push_back(cfg.texDraw);
-    rendering.frameNum.push_back(cfg.frameNum);
-    rendering.rowIndex.push_back(cfg.rowIndex);
-    rendering.frameMin.push_back(cfg.frameMin);
-    rendering.frameMax.push_back(cfg.frameMax);
-    rendering.frameSpd.push_back(cfg.frameSpeed);
+    rendering.varID.resize(end, cfg.vID);
+    rendering.typeID.resize(end, cfg.tID);
+    rendering.col.resize(end, cfg.color);
+
+    rendering.rotation.resize(end, 0.0f);
+    rendering.texDraw.append(n, cfg.texDraw);
+    rendering.frameNum.resize(end, cfg.frameNum);
+    rendering.rowIndex.resize(end, cfg.rowIndex);
+    rendering.frameMin.resize(end, cfg.frameMin);
+    rendering.frameMax.resize(end, cfg.frameMax);
+    rendering.frameSpd.resize(end, cfg.frameSpeed);
 
     // --- STATS & VARS ---
-    stats.health.push_back(cfg.health);
-    stats.maxHealth.push_back(cfg.health);
-
-    EntityVars newVars;
-    for (auto const &[key, val] : cfg.customVars) {
-        newVars.values[key] = val;
+    stats.health.resize(end, cfg.health);
+    stats.maxHealth.resize(end, cfg.health);
+
+    EntityVars proto;
+    for (auto const &[slot, val] : cfg.varLayout)
+        proto.set(slot, val);
+    vars.resize(end, proto);
+    behs.resize(end, {cfg.behMask});
+
+    // --- HANDLES ---
+    for (size_t i = first; i < end; ++i) {
+        AllocHandle(i);
+        if (!out.empty())
+            out[k++] = i;
     }
-    vars.push_back(newVars);
 
-    EntityBehaves newBehs;
-    for (auto const &[key, val] : cfg.customBehs) {
-        newBehs.values[key] = val;
-    }
-    behs.push_back(newBehs);
+    return true;
+}
+
+void EntityManager::WriteRow(size_t i, const EntityConfig &cfg, Vector2 pos) {
+    // --- PHYSICS (Must match PhysicsComponent struct exactly) ---
+    physics.pos[i] = pos;
+    physics.prevPos[i] = pos;
+    physics.vel[i] = {0, 0};
+    physics.siz[i] = cfg.size;
+    physics.scale[i] = {1.0f, 1.0f};
+    physics.rect[i] = {pos.x, pos.y, cfg.size.x, cfg.size.y};
+    physics.rectX[i] = {0, 0, 0, 0};
+    physics.rectY[i] = {0, 0, 0, 0};
+    physics.mass[i] = 1.0f;
+    physics.gravity[i] = cfg.gravity;
+    physics.layer[i] = cfg.layer;
+    physics.mask[i] = cfg.mask;
+    physics.restTicks[i] = 0;
+    physics.active.set(i, true);
+    physics.initialized.set(i, false);
+    physics.collide.set(i, cfg.canCollide);
+    physics.grounded.set(i, false);
+    physics.walled.set(i, false);
+    physics.sleeping.set(i, false);
+    physics.dormant.set(i, false);
+    physics.reduced.set(i, false);
 
-    TraceLog(LOG_INFO, "ADDING ENTITY: [%s] Gravity: %.2f", typeName.c_str(),
-             cfg.gravity);
-    return physics.pos.size() - 1;
+    // --- RENDERING (Must match RenderComponent struct exactly) ---
+    rendering.varID[i] = cfg.vID;
+    rendering.typeID[i] = cfg.tID;
+    rendering.col[i] = cfg.color;
+
+    rendering.rotation[i] = 0.0f;
+    rendering.texDraw.set(i, cfg.texDraw);
+    rendering.frameNum[i] = cfg.frameNum;
+    rendering.rowIndex[i] = cfg.rowIndex;
+    rendering.frameMin[i] = cfg.frameMin;
+    rendering.frameMax[i] = cfg.frameMax;
+    rendering.frameSpd[i] = cfg.frameSpeed;
+
+    // --- STATS & VARS ---
+    stats.health[i] = cfg.health;
+    stats.maxHealth[i] = cfg.health;
+
+    vars[i] = EntityVars{};
+    for (auto const &[slot, val] : cfg.varLayout)
+        vars[i].set(slot, val);
+    behs[i] = {cfg.behMask};
 }
 
 void EntityManager::LoadConfigs(const std::string &path) {
@@ -144,18 +265,19 @@ void EntityManager::LoadConfigs(const std::string &path) {
             return;
         }
 
-        // 1. Reset state
-        EntityRegistry.clear();
-        IdToName.clear();
-        ConfigMap.clear();
+        // 1. Parse into fresh tables. typeConfigs points into ConfigMap, so
+        // a file that fails halfway must leave the old ones in place.
+        std::unordered_map<std::string, int> registry;
+        std::unordered_map<int, std::string> idToName;
+        std::unordered_map<std::string, EntityConfig> configs;
 
         // 2. Optional: Pre-load the Registry if entity_types exists
         if (data.contains("entity_types") && data["entity_types"].is_array()) {
             for (const auto &item : data["entity_types"]) {
                 std::string name = item.value("name", "UNKNOWN");
                 int id = item.value("id", 0);
-                EntityRegistry[name] = id;
-                IdToName[id] = name;
+                registry[name] = id;
+                idToName[id] = name;
             }
         }
 
@@ -168,16 +290,16 @@ void EntityManager::LoadConfigs(const std::string &path) {
             cfg.from_json(
                 configData); // This already fills customVars and customBehs
 
-            if (EntityRegistry.find(name) == EntityRegistry.end()) {
-                EntityRegistry[name] = cfg.tID;
-                IdToName[cfg.tID] = name;
+            if (registry.find(name) == registry.end()) {
+                registry[name] = cfg.tID;
+                idToName[cfg.tID] = name;
                 TraceLog(LOG_INFO, "FILEIO: Self-registered [%s] with ID %d",
                          name.c_str(), cfg.tID);
             } else {
-                cfg.tID = EntityRegistry[name];
+                cfg.tID = registry[name];
             }
 
-            ConfigMap[name] = cfg;
+            configs[name] = cfg;
 
             // Parse customVars safely
             if (configData.contains("customVars") &&
@@ -198,11 +320,72 @@ void EntityManager::LoadConfigs(const std::string &path) {
                 }
             }
 
-            ConfigMap[name] = cfg;
+            // Intern var names once here so spawns and systems only ever
+            // deal in slots
+            for (auto const &[key, val] : cfg.customVars)
+                cfg.varLayout.push_back({VarSlots.Intern(key), val});
+
+            configs[name] = cfg;
         }
 
+        // Parsed whole; the old configs live until typeConfigs moves off
+        // them below
+        EntityRegistry.swap(registry);
+        IdToName.swap(idToName);
+        ConfigMap.swap(configs);
+
         LoadTypes();
 
+        // 4. Dense type IDs (ascending registry ID) and the per-type tables
+        // the systems index with them
+        DenseToType.clear();
+        TypeToDense.clear();
+        for (auto const &[name, id] : EntityRegistry)
+            DenseToType.push_back(id);
+        std::sort(DenseToType.begin(), DenseToType.end());
+        DenseToType.erase(std::unique(DenseToType.begin(), DenseToType.end()),
+                          DenseToType.end());
+        for (size_t d = 0; d < DenseToType.size(); ++d)
+            TypeToDense[DenseToType[d]] = d;
+
+        typeConfigs.assign(DenseToType.size(), nullptr);
+        typeBehaves.assign(DenseToType.size(), 0);
+        for (auto &[name, cfg] : ConfigMap) {
+            cfg.behMask = CompileBehaves(cfg.customBehs);
+
+            int dense = GetDenseType(cfg.tID);
+            typeConfigs[dense] = &cfg;
+            typeBehaves[dense] = cfg.behMask;
+        }
+
+        // Whether a type runs tile collision at all follows from its mask
+        uint32_t tileLayers = 0;
+        for (auto const &[name, cfg] : ConfigMap) {
+            if (cfg.behMask & (1u << BEH_TILE))
+                tileLayers |= cfg.layer;
+        }
+        for (auto &[name, cfg] : ConfigMap)
+            cfg.canCollide = (cfg.mask & tileLayers) != 0;
+
+        // Hot reload: live entities pick up the new behavior sets, and the
+        // dense IDs may have shifted under the buckets
+        for (size_t i = 0; i < behs.size(); ++i) {
+            int dense = GetDenseType(rendering.typeID[i]);
+            behs[i].mask = (dense >= 0) ? typeBehaves[dense] : 0;
+            if (const EntityConfig *cfg = dense >= 0 ? typeConfigs[dense]
+                                                     : nullptr) {
+                physics.layer[i] = cfg->layer;
+                physics.mask[i] = cfg->mask;
+                physics.collide.set(i, cfg->canCollide);
+            }
+            Wake(i); // Refiled and re-collided under the new layers
+            // LOD rings may have changed too; UpdateLod finds them again
+            physics.dormant.set(i, false);
+            physics.reduced.set(i, false);
+        }
+        RebuildBuckets();
+        tmap.InvalidateColliders(); // Tile layers may have changed
+
         for (auto const &[name, cfg] : ConfigMap) {
             TraceLog(LOG_INFO, "Loaded: [%s] ID: %d Gravity: %.2f",
                      name.c_str(), cfg.tID, cfg.gravity);
@@ -221,30 +404,161 @@ void EntityManager::LoadConfigs(const std::string &path) {
 }
 
 void EntityManager::UpdateAll(float dt) {
-    for (size_t i = 0; i < physics.pos.size(); ++i) {
-        if (!physics.active[i] || rendering.typeID[i] == EntityTys::TYTILE)
+    static BitColumn dead;
+    Integrate(dt, true, dead);
+
+    // Removal is deferred to the end-of-tick flush so no loop ever sees the
+    // SoA shift underneath it; recorded in index order so the command
+    // stream doesn't depend on thread scheduling
+    ForEachSet(dead, [&](size_t i) { Commands().Destroy(GetHandle(i)); });
+}
+
+void EntityManager::UpdateLod(Vector2 focus) {
+    uint32_t slice = lodTick++ % LodSlices;
+
+    // Types without a far ring are never touched here, so their bits stay
+    // clear and they run every tick
+    for (size_t t = 0; t < typeBuckets.size(); ++t) {
+        const EntityConfig *cfg = typeConfigs[t];
+        if (!cfg || cfg->lodFar <= 0.0f)
             continue;
 
+        const std::vector<uint32_t> &bucket = typeBuckets[t];
+        size_t begin = bucket.size() * slice / LodSlices;
+        size_t end = bucket.size() * (slice + 1) / LodSlices;
+        for (size_t k = begin; k < end; ++k) {
+            size_t i = sparse[bucket[k]];
+            const Rectangle &r = physics.rect[i];
+            float d = std::max(std::abs(r.x + r.width * 0.5f - focus.x),
+                               std::abs(r.y + r.height * 0.5f - focus.y));
+            physics.dormant.set(i, d > cfg->lodFar);
+            physics.reduced.set(i, d > cfg->lodNear);
+        }
+    }
+}
+
+void EntityManager::SnapshotPositions() {
+    physics.prevPos.assign(physics.pos.begin(), physics.pos.end());
+}
+
+void EntityManager::Integrate(float dt, bool parallel, BitColumn &dead) {
+    dead.reset(physics.active.size());
+
+    // Gravity is tuned as a per-tick velocity change at TUNING_RATE
+    const float tickScale = dt * TUNING_RATE;
+    const float sweepAt =
+        CollisionSystem::CELL_SIZE * CollisionSystem::SweepFraction;
+
+    auto step = [&](size_t i) {
+        const Vector2 start = physics.pos[i];
         if (!physics.grounded[i]) {
-            physics.vel[i].y += physics.gravity[i];
+            physics.vel[i].y += physics.gravity[i] * tickScale;
         } else if (physics.vel[i].y > 0.0f) {
             physics.vel[i].y = 0.0f;
         }
-        physics.grounded[i] = false;
-
-        physics.pos[i].x += physics.vel[i].x * dt;
-        cS.ResolveAxis(*this, i, true);
-
-        physics.pos[i].y += physics.vel[i].y * dt;
-        cS.ResolveAxis(*this, i, false);
+        physics.grounded.set(i, false);
+
+        Vector2 delta = {physics.vel[i].x * dt, physics.vel[i].y * dt};
+        if (physics.collide[i] && (std::abs(delta.x) > sweepAt ||
+                                   std::abs(delta.y) > sweepAt)) {
+            // Fast enough to skip a tile between steps: sweep, then let the
+            // probes settle anything it started out overlapping
+            cS.SweptMove(*this, i, delta);
+            cS.ResolveAxis(*this, i, true);
+            cS.ResolveAxis(*this, i, false);
+        } else {
+            physics.pos[i].x += delta.x;
+            cS.ResolveAxis(*this, i, true);
+
+            physics.pos[i].y += delta.y;
+            cS.ResolveAxis(*this, i, false);
+        }
         SyncRect(*this, i);
 
         stats.health[i] = std::clamp(stats.health[i], 0.0f, stats.maxHealth[i]);
-
-        if (stats.health[i] <= 0.0f) {
-            this->FastRemove(i);
+        if (stats.health[i] <= 0.0f)
+            dead.set(i, true);
+
+        // Resting on the ground still falls a little and gets pushed back
+        // every other step, so "at rest" means it ended where it began
+        if (physics.pos[i].x != start.x || physics.pos[i].y != start.y ||
+            physics.vel[i].x != 0.0f) {
+            physics.restTicks[i] = 0;
+        } else if (++physics.restTicks[i] >= SleepTicks) {
+            physics.sleeping.set(i, true);
+            physics.vel[i] = {0, 0};
+            physics.grounded.set(i, physics.gravity[i] > 0.0f);
         }
+    };
+
+    // A sleeper whose velocity was written since the last step joins this
+    // one; it was zeroed when it fell asleep
+    auto wake = [&](size_t i) {
+        if (physics.vel[i].x != 0.0f || physics.vel[i].y != 0.0f)
+            Wake(i);
+    };
+
+    auto run = [&](size_t wBegin, size_t wEnd) {
+        ForEachBit(
+            wBegin, wEnd,
+            [&](size_t w) {
+                return physics.active.words[w] & physics.sleeping.words[w];
+            },
+            wake);
+        ForEachBit(
+            wBegin, wEnd, [&](size_t w) { return AwakeWord(w); }, step);
+    };
+
+    size_t words = physics.active.WordCount();
+    if (!parallel) {
+        run(0, words);
+        return;
     }
+
+    // An entity reads only the static tilemap and writes only its own row,
+    // so blocks are independent. Blocks are whole words of the bit columns,
+    // which keeps two threads from ever writing the same grounded/walled word.
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, words, IntegrateGrain),
+                      [&](const tbb::blocked_range<size_t> &r) {
+                          run(r.begin(), r.end());
+                      });
+}
+
+bool EntityManager::CheckDeterminism(int frames, float dt) const {
+    EntityManager serial = *this;
+    EntityManager parallel = *this;
+    BitColumn dead;
+
+    for (int f = 0; f < frames; ++f) {
+        serial.Integrate(dt, false, dead);
+        parallel.Integrate(dt, true, dead);
+    }
+
+    auto same = [](const auto &a, const auto &b) {
+        return a.size() == b.size() &&
+               std::memcmp(a.data(), b.data(),
+                           a.size() * sizeof(*a.data())) == 0;
+    };
+
+    const PhysicsComponent &a = serial.physics, &b = parallel.physics;
+    bool ok = same(a.pos, b.pos) && same(a.vel, b.vel) &&
+              same(a.grounded.words, b.grounded.words) &&
+              same(a.walled.words, b.walled.words) &&
+              same(a.sleeping.words, b.sleeping.words) &&
+              same(serial.stats.health, parallel.stats.health);
+
+    if (ok) {
+        TraceLog(LOG_INFO,
+                 "DETERMINISM: Serial and parallel agree over %d frames "
+                 "(%zu entities)",
+                 frames, a.pos.size());
+    } else {
+        TraceLog(LOG_WARNING,
+                 "DETERMINISM: Serial and parallel diverged within %d frames "
+                 "(%zu entities)",
+                 frames, a.pos.size());
+    }
+    return ok;
 }
 
 void EntityManager::DrawAll(Camera2D camera) {
@@ -256,10 +570,9 @@ void EntityManager::DrawAll(Camera2D camera) {
 
     Texture2D pixelTex = am.textures[TEX_DEF];
 
-    for (size_t i = 0; i < physics.pos.size(); ++i) {
-        if (!physics.active[i])
-            continue;
-        const Rectangle &r = physics.rect[i];
+    ForEachSet(physics.active, [&](size_t i) {
+        Vector2 p = RenderPos(i);
+        const Rectangle r = {p.x, p.y, physics.siz[i].x, physics.siz[i].y};
 
         if (CheckCollisionRecs(r, view)) {
             float sX = physics.scale[i].x;
@@ -326,31 +639,176 @@ void EntityManager::DrawAll(Camera2D camera) {
 
             // --- 4. Heavy Landing & Screen Shake ---
             if (sY < 0.99f && physics.grounded[i]) {
-                if (vars[i].get("AIR_TIME") > 1.0f) {
-                    vars[i].set("AIR_TIME", 0.0f);
+                if (vars[i].get(Var::AIR_TIME) > 1.0f) {
+                    vars[i].set(Var::AIR_TIME, 0.0f);
                 }
                 // Impact Ring
                 DrawCircleV({dest.x, dest.y}, r.width * (1.0f - sY) * 3.0f,
                             Fade(BLACK, 0.4f));
             }
         }
+    });
+}
+
+void EntityManager::Tombstone(size_t index) {
+    std::vector<size_t> one = {index};
+    RemoveBatch(one);
+}
+
+void EntityManager::RemoveBatch(std::vector<size_t> &indices) {
+    // Rows are tombstoned, not shifted: the handle retires now, the row goes
+    // on freeRows for the next spawn, and the columns are only touched again
+    // by Compact() once enough holes pile up
+    for (size_t index : indices) {
+        uint32_t slot = dense[index];
+        if (slot == InvalidSlot)
+            continue; // Listed twice
+
+        BucketErase(slot, rendering.typeID[index]);
+        generations[slot]++;
+        sparse[slot] = InvalidSlot;
+        freeSlots.push_back(slot);
+
+        dense[index] = InvalidSlot;
+        physics.active.set(index, false);
+        freeRows.push_back(index);
+    }
+
+    if (freeRows.size() >= CompactMinRows &&
+        freeRows.size() > dense.size() * CompactRatio)
+        Compact();
+}
+
+void EntityManager::Compact() {
+    if (freeRows.empty())
+        return;
+
+    // Swap the tail into every hole, highest first so the row moved in is
+    // always live, and mirror each move in the indirection table
+    std::sort(freeRows.begin(), freeRows.end(), std::greater<size_t>());
+    for (size_t index : freeRows) {
+        size_t last = dense.size() - 1;
+        if (index < last) {
+            dense[index] = dense[last];
+            sparse[dense[index]] = index;
+        }
+        dense.pop_back();
+    }
+
+    physics.RemoveBatch(freeRows);
+    rendering.RemoveBatch(freeRows);
+    stats.RemoveBatch(freeRows);
+
+    SwapRemoveBatch(vars, freeRows);
+    SwapRemoveBatch(behs, freeRows);
+
+    freeRows.clear();
+}
+
+void EntityManager::Remove(EntityHandle h) {
+    size_t i = Resolve(h);
+    if (i != InvalidIndex)
+        Tombstone(i);
+}
+
+void EntityManager::Clear() {
+    physics.Clear();
+    rendering.Clear();
+    stats.Clear();
+
+    vars.clear();
+    behs.clear();
+    DiscardCommands();
+
+    // Keep the generations so handles from before the clear stay stale
+    freeSlots.clear();
+    for (size_t slot = 0; slot < sparse.size(); ++slot) {
+        if (sparse[slot] != InvalidSlot)
+            generations[slot]++;
+        sparse[slot] = InvalidSlot;
+        freeSlots.push_back(slot);
+    }
+    dense.clear();
+    freeRows.clear();
+
+    for (auto &bucket : typeBuckets)
+        bucket.clear();
+}
+
+EntityHandle EntityManager::AllocHandle(size_t denseIndex) {
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = sparse.size();
+        sparse.push_back(InvalidSlot);
+        generations.push_back(0);
+    }
+
+    sparse[slot] = denseIndex;
+    if (denseIndex < dense.size())
+        dense[denseIndex] = slot; // Refilled tombstone
+    else
+        dense.push_back(slot);
+    BucketInsert(slot, rendering.typeID[denseIndex]);
+    return {slot, generations[slot]};
+}
+
+void EntityManager::BucketInsert(uint32_t slot, int typeID) {
+    int t = GetDenseType(typeID);
+    if (t < 0)
+        return;
+
+    if (slot >= bucketPos.size())
+        bucketPos.resize(slot + 1);
+    bucketPos[slot] = typeBuckets[t].size();
+    typeBuckets[t].push_back(slot);
+}
+
+void EntityManager::BucketErase(uint32_t slot, int typeID) {
+    int t = GetDenseType(typeID);
+    if (t < 0)
+        return;
+
+    std::vector<uint32_t> &bucket = typeBuckets[t];
+    uint32_t pos = bucketPos[slot];
+    bucket[pos] = bucket.back();
+    bucketPos[bucket[pos]] = pos;
+    bucket.pop_back();
+}
+
+void EntityManager::RebuildBuckets() {
+    typeBuckets.assign(DenseToType.size(), {});
+    for (size_t i = 0; i < dense.size(); ++i) {
+        if (dense[i] != InvalidSlot)
+            BucketInsert(dense[i], rendering.typeID[i]);
     }
 }
 
-void EntityManager::FastRemove(size_t index) {
-    physics.Remove(index);
-    rendering.Remove(index);
-    stats.Remove(index);
+bool EntityManager::IsTileType(int typeID) const {
+    int t = GetDenseType(typeID);
+    return t >= 0 && (typeBehaves[t] & (1u << BEH_TILE));
+}
+
+EntityHandle EntityManager::GetHandle(size_t i) const {
+    if (i >= dense.size() || dense[i] == InvalidSlot)
+        return NullHandle;
+    uint32_t slot = dense[i];
+    return {slot, generations[slot]};
 }
 
-int EntityManager::GetActiveCount() {
-    int count = 0;
-    for (bool isActive : physics.active)
-        if (isActive)
-            count++;
-    return count;
+bool EntityManager::IsValid(EntityHandle h) const {
+    return h.index < sparse.size() && generations[h.index] == h.generation &&
+           sparse[h.index] != InvalidSlot;
 }
 
+size_t EntityManager::Resolve(EntityHandle h) const {
+    return IsValid(h) ? sparse[h.index] : InvalidIndex;
+}
+
+int EntityManager::GetActiveCount() { return physics.active.Count(); }
+
 void EntityManager::SyncRect(EntityManager &em, size_t i) {
     // The main bounding box
     em.physics.rect[i] = {em.physics.pos[i].x, em.physics.pos[i].y,
@@ -369,23 +827,41 @@ void EntityManager::SyncRect(EntityManager &em, size_t i) {
 }
 
 // Management Functions
-void EntitySystem(EntityManager &em) {
-    for (size_t i = 0; i < em.rendering.typeID.size(); ++i) {
-        TileSystem(em, i);
-        ObjectSystem(em, i);
-        CharacterSystem(em, i);
-        EnemySystem(em, i);
-
-        BehaveSystem(em, i);
+void EntitySystem(EntityManager &em, float dt) {
+    em.ForEachOfType(EntityTys::TYHITBOX,
+                     [&](size_t i) { ObjectSystem(em, i, dt); });
+    em.ForEachOfType(EntityTys::TYHURTBOX,
+                     [&](size_t i) { ObjectSystem(em, i, dt); });
+    em.ForEachOfType(EntityTys::TYBULLET,
+                     [&](size_t i) { ObjectSystem(em, i, dt); });
+
+    em.ForEachOfType(EntityTys::TYCHARACTER,
+                     [&](size_t i) { CharacterSystem(em, i, dt); });
+
+    for (int type : {EntityTys::TYWALKER, EntityTys::TYBOUNCER,
+                     EntityTys::TYSHOOTER}) {
+        em.ForEachOfType(type, [&](size_t i) {
+            if (!em.physics.dormant[i])
+                EnemySystem(em, i, dt);
+        });
     }
+
+    BehaveSystem(em, dt);
 }
 
 void EntityDrawing(EntityManager &em) {
-    for (size_t i = 0; i < em.rendering.typeID.size(); ++i) {
-        ObjectDrawing(em, i);
-        CharacterDrawing(em, i);
-        EnemyDrawing(em, i);
+    em.ForEachOfType(EntityTys::TYHITBOX,
+                     [&](size_t i) { ObjectDrawing(em, i); });
+    em.ForEachOfType(EntityTys::TYHURTBOX,
+                     [&](size_t i) { ObjectDrawing(em, i); });
+
+    em.ForEachOfType(EntityTys::TYCHARACTER,
+                     [&](size_t i) { CharacterDrawing(em, i); });
 
-        BehaveDrawing(em, i);
+    for (int type : {EntityTys::TYWALKER, EntityTys::TYBOUNCER,
+                     EntityTys::TYSHOOTER}) {
+        em.ForEachOfType(type, [&](size_t i) { EnemyDrawing(em, i); });
     }
+
+    BehaveDrawing(em);
 }
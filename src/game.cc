@@ -1,11 +1,16 @@
 #include "include/game.h"
 #include "include/assets.h"
 #include "include/collision.h"
+#include "include/commands.h"
 #include "include/constants.h"
 #include "include/data.h"
 #include "include/entities.h"
+#include "include/input.h"
 #include "include/level.h"
 #include "include/mod.h"
+#include "include/objects.h"
+#include "include/streaming.h"
+#include "include/tiles.h"
 #include "raylib.h"
 #include "raymath.h"
 #include "rlgl.h"
@@ -18,6 +23,13 @@ struct sockaddr_in serverAddr;
 std::string statusMessage = "";
 float messageTimer = 0.0f;
 
+// Chunks are streamed and LOD rings centred on the middle of the view;
+// camera.target is its corner, since the offset is left at zero
+static Vector2 ViewCenter() {
+    return GetScreenToWorld2D(
+        {GetScreenWidth() * 0.5f, GetScreenHeight() * 0.5f}, camera);
+}
+
 void Game::Init() {
     // am.PlayMus(MUS_CHASE);
 }
@@ -25,13 +37,51 @@ void Game::Init() {
 void Game::Update(float dt) {
     if (dt <= 0.0f)
         return;
-    UpdateState(dt);
+
+    LatchInput();
+
+    // Run as many fixed ticks as real time allows. A long stall (breakpoint,
+    // window drag) is capped instead of replayed all at once.
+    const float tickDt = 1.0f / tickRate;
+    accumulator += std::min(dt, MaxTicksPerFrame * tickDt);
+    while (accumulator >= tickDt) {
+        Tick(tickDt);
+        accumulator -= tickDt;
+    }
+    em.renderAlpha = accumulator / tickDt;
+
+    UpdateFrame(dt);
+
+    streamer.Update(ViewCenter());
+
+    // Editor tools record outside the tick; apply them before drawing
+    FlushCommands(em);
+
     ManageState();
 }
 
+void Game::Tick(float dt) {
+    // Editor paints since the last tick are re-merged before physics reads,
+    // and whatever was asleep on them has to fall or get pushed out
+    static std::vector<Rectangle> edited;
+    edited.clear();
+    tmap.BakeColliders(&edited);
+    for (const Rectangle &area : edited)
+        cS.WakeArea(em, area);
+    em.SnapshotPositions();
+    UpdateState(dt);
+
+    // Single point where spawns/removals recorded this tick hit the SoA
+    FlushCommands(em);
+    ConsumeInput();
+}
+
 void Game::Draw() { DrawState(); }
 
-void Game::Unload() { lm.Clear(); }
+void Game::Unload() {
+    streamer.Close(); // Writes the loaded chunks back
+    lm.Clear();
+}
 
 void Game::ManageState() {
     switch (GameState) {
@@ -55,16 +105,45 @@ void Game::ManageState() {
 void Game::UpdateState(float dt) {
     switch (GameState) {
     case LEVEL:
+        // Debug: replay the physics serially and in parallel from here
+        if (TickKeyPressed(KEY_F6))
+            em.CheckDeterminism(300, dt);
+
+        em.UpdateLod(ViewCenter());
         em.UpdateAll(dt);
-        EntitySystem(em);
+        cS.UpdateGrid(em); // Behaviour queries see this tick's positions
+        EntitySystem(em, dt);
         cS.ResolveAll(em, dt);
+        cS.UpdateContacts(em);
+        ContactSystem(em, cS.Contacts());
+
+        // Only rescan for the character once the cached handle goes stale
+        if (!em.IsValid(player)) {
+            em.ForEachOfType(EntityTys::TYCHARACTER, [&](size_t i) {
+                if (!em.IsValid(player))
+                    player = em.GetHandle(i);
+            });
+        }
+        break;
+    case EDITOR:
+        EntitySystem(em, dt);
+        break;
+    default:
+        break;
+    }
+}
 
+void Game::UpdateFrame(float dt) {
+    switch (GameState) {
+    case LEVEL:
         cameraOffset = {GetScreenWidth() / 1.5f, GetScreenHeight() / 1.5f};
         cameraZoom = 0.75f;
-        for (size_t i = 0; i < em.rendering.typeID.size(); ++i) {
-            if (em.rendering.typeID[i] == EntityRegistry["CHARACTER"])
-                cameraTarg = {em.physics.pos[i].x - cameraOffset.x,
-                              em.physics.pos[i].y - cameraOffset.y};
+
+        // Follow the interpolated position so the camera moves in step with
+        // what gets drawn
+        if (size_t p = em.Resolve(player); p != EntityManager::InvalidIndex) {
+            Vector2 pos = em.RenderPos(p);
+            cameraTarg = {pos.x - cameraOffset.x, pos.y - cameraOffset.y};
         }
 
         camera.zoom = cameraZoom;
@@ -72,32 +151,54 @@ void Game::UpdateState(float dt) {
 
         break;
     case EDITOR:
-        EntitySystem(em);
         EditLevel(dt);
 
         camera.zoom = cameraZoom;
         camera.target = cameraTarg;
 
-        if (IsKeyPressed(KEY_SAVE)) {
-            if (lm.Save("bin/content/level/level-1.json")) {
-                statusMessage = "Level Saved!";
+        // Saves are written in the background; the result shows up here
+        // a few frames later. A streamed level saves chunk by chunk.
+        if (IsKeyPressed(KEY_SAVE) && streamer.IsOpen()) {
+            streamer.Flush();
+            statusMessage = "Saving Chunks...";
+            messageTimer = 3.0f;
+        } else if (IsKeyPressed(KEY_SAVE)) {
+            if (lm.SaveAsync("bin/content/level/level-1.json")) {
+                statusMessage = "Saving...";
             } else {
-                statusMessage = "Save Failed!";
+                statusMessage = "Still Saving!";
             }
             messageTimer = 3.0f; // Show for 3 seconds
-            cS.ResetTileGrid();
         } else if (IsKeyPressed(KEY_LOAD)) {
+            streamer.Close();
             if (lm.Load("bin/content/level/level-1.json")) {
                 statusMessage = "Level Loaded!";
             } else {
                 statusMessage = "Load Failed (File Not Found)!";
             }
             messageTimer = 3.0f;
-            cS.ResetTileGrid();
+        } else if (IsKeyPressed(KEY_STREAM)) {
+            // Made from a level with: game --split <level> <dir>
+            if (streamer.IsOpen()) {
+                streamer.Close();
+                statusMessage = "Streaming Stopped";
+            } else if (streamer.Open("bin/content/level/level-1")) {
+                statusMessage = "Streaming Chunks";
+            } else {
+                statusMessage = "Stream Failed!";
+            }
+            messageTimer = 3.0f;
+        }
+
+        if (LevelManager::SaveState saved = lm.PollSave();
+            saved == LevelManager::SAVED || saved == LevelManager::FAILED) {
+            statusMessage =
+                saved == LevelManager::SAVED ? "Level Saved!" : "Save Failed!";
+            messageTimer = 3.0f;
         }
 
         if (messageTimer > 0)
-            messageTimer -= GetFrameTime();
+            messageTimer -= dt;
 
         break;
     default:
@@ -116,6 +217,7 @@ void Game::DrawState() {
     case LEVEL:
         BeginMode2D(camera);
 
+        tmap.Draw(camera);
         em.DrawAll(camera);
         EntityDrawing(em);
 
@@ -125,6 +227,7 @@ void Game::DrawState() {
     case EDITOR:
         BeginMode2D(camera);
 
+        tmap.Draw(camera);
         em.DrawAll(camera);
         EntityDrawing(em);
 
@@ -138,6 +241,7 @@ void Game::DrawState() {
 
         int entityCount = em.GetActiveCount();
         DrawText(TextFormat("Entities: %d", entityCount), 10, 90, 20, GREEN);
+        DrawText(TextFormat("Tiles: %zu", tmap.Count()), 10, 110, 20, GREEN);
 
         Vector2 messageLoc =
             Vector2{GetScreenWidth() / 2.0f, GetScreenHeight() / 2.0f};
@@ -225,14 +329,10 @@ void Game::EditLevel(float dt) {
     else if (IsKeyPressed(KEY_V))
         EToolNum = EntityTys::TYWALKER;
 
-    if (IsKeyDown(KEY_R)) {
+    if (IsKeyDown(KEY_R))
         RemoveEntity();
-        cS.ResetTileGrid();
-    }
-    if (IsKeyDown(KEY_PLACE)) {
+    if (IsKeyDown(KEY_PLACE))
         SpawnEntity(EToolNum, snapped);
-        cS.ResetTileGrid();
-    }
 
     if (IsKeyPressed(KEY_F5)) {
         em.LoadConfigs("assets/entities.json");
@@ -243,6 +343,9 @@ void Game::EditLevel(float dt) {
 void Game::SpawnEntity(int nm, Vector2 tg) {
     Vector2 spawnPos = {tg.x - GRID_SIZE / 2, tg.y - GRID_SIZE / 2};
 
+    if (tmap.IsSolid(TileMap::CellOf(tg.x), TileMap::CellOf(tg.y)))
+        return;
+
     for (size_t i = 0; i < em.physics.pos.size(); ++i) {
         if (em.physics.active[i] && em.physics.pos[i].x == spawnPos.x &&
             em.physics.pos[i].y == spawnPos.y)
@@ -251,22 +354,33 @@ void Game::SpawnEntity(int nm, Vector2 tg) {
 
     if (IdToName.count(nm)) {
         am.PlaySfx(SFX_ADDENT);
-        em.AddEntityJ(IdToName[nm], spawnPos);
+        Commands().Spawn(nm, spawnPos);
     }
 }
 
 void Game::RemoveEntity() {
-    for (size_t i = 0; i < em.physics.pos.size();) {
-        if (!em.physics.active[i]) {
-            i++;
-            continue;
+    int startX = TileMap::CellOf(removeRect.x);
+    int startY = TileMap::CellOf(removeRect.y);
+    int endX = TileMap::CellOf(removeRect.x + removeRect.width);
+    int endY = TileMap::CellOf(removeRect.y + removeRect.height);
+
+    for (int y = startY; y <= endY; ++y) {
+        for (int x = startX; x <= endX; ++x) {
+            if (tmap.IsSolid(x, y) &&
+                CheckCollisionRecs(TileMap::CellRect(x, y), removeRect)) {
+                am.PlaySfx(SFX_REMOVENT);
+                tmap.Erase(x, y);
+            }
         }
+    }
+
+    for (size_t i = 0; i < em.physics.pos.size(); ++i) {
+        if (!em.physics.active[i])
+            continue;
 
         if (CheckCollisionRecs(em.physics.rect[i], removeRect)) {
             am.PlaySfx(SFX_REMOVENT);
-            em.FastRemove(i);
-        } else {
-            i++;
+            Commands().Destroy(em.GetHandle(i));
         }
     }
 }
@@ -2,6 +2,42 @@
 
 #include "entities.h"
 #include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
 
-void BehaveSystem(EntityManager &em, size_t i);
-void BehaveDrawing(EntityManager &em, size_t i);
+// Behaviors are compiled from the "behaviors" names in entities.json into a
+// bitmask at LoadConfigs time; the per-frame path only ever sees the bits.
+enum BehaveId {
+    BEH_CHASE_PLAYER,
+    BEH_ENEMY,
+    BEH_FLIP_ON_EDGE,
+    BEH_FLIP_ON_WALL,
+    BEH_HAZARD,
+    BEH_JUMP_ON_GROUND,
+    BEH_JUMP_ON_WALL,
+    BEH_ONE_WAY,
+    BEH_TILE,
+    BEH_COUNT
+};
+
+// Runs one behavior over every entity that has it
+using BehaveFn = void (*)(EntityManager &em, const std::vector<size_t> &batch,
+                          float dt);
+using BehaveDrawFn = void (*)(EntityManager &em,
+                              const std::vector<size_t> &batch);
+
+struct BehaveDef {
+    const char *name;
+    BehaveFn update;
+    BehaveDrawFn draw;
+};
+
+extern const BehaveDef Behaves[BEH_COUNT];
+
+int FindBehave(const std::string &name);
+uint32_t CompileBehaves(const std::map<std::string, float> &customBehs);
+
+void BehaveSystem(EntityManager &em, float dt);
+void BehaveDrawing(EntityManager &em);
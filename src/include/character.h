@@ -2,14 +2,14 @@
 #include <cmath>
 #include <cstddef>
 
-void CharacterSystem(EntityManager &em, size_t i);
+void CharacterSystem(EntityManager &em, size_t i, float dt);
 void CharacterDrawing(EntityManager &em, size_t i);
 
-void CharacterScaleJuice(EntityManager &em, size_t i);
+void CharacterScaleJuice(EntityManager &em, size_t i, float dt);
 
-void CharacterStates(EntityManager &em, size_t i);
-void CharacterMovement(EntityManager &em, size_t i);
+void CharacterStates(EntityManager &em, size_t i, float dt);
+void CharacterMovement(EntityManager &em, size_t i, float dt);
 
-void CharacterJump(EntityManager &em, size_t i);
-void CharacterDash(EntityManager &em, size_t i);
-void CharacterTricks(EntityManager &em, size_t i);
+void CharacterJump(EntityManager &em, size_t i, float dt);
+void CharacterDash(EntityManager &em, size_t i, float dt);
+void CharacterTricks(EntityManager &em, size_t i, float dt);
@@ -2,31 +2,141 @@
 
 #include "entities.h"
 #include <cstddef>
+#include <cstdint>
 #include <raylib.h>
+#include <span>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+// Bucket of the dynamic spatial hash, one per occupied CHUNK_CELLS square
+struct GridChunk {
+    std::vector<int> slots;       // Entity slots whose center lies inside
+    uint32_t layers = 0;          // Layer bits at least one of them is on
+    uint32_t layerCount[32] = {}; // Slots per bit, so `layers` can shrink
+};
+
 struct CollisionResult {
     bool hit = false;
     int typeID = -1;
+    uint32_t layer = 0;
     Vector2 pos = {0, 0};
     Vector2 siz = {0, 0};
 };
 
+// What a spatial query reports: things on one of `layers` and, narrower,
+// of one of `types`. Types are matched by dense type ID, so a mask covers
+// the first 64 registered types.
+struct QueryFilter {
+    uint32_t layers = ~0u;  // Layer bits, all set = anything, even layer 0
+    uint64_t types = ~0ull; // Bit per dense type ID, all set = any type
+    bool tiles = true;      // Tile colliders
+    bool entities = true;   // Dynamic entities
+    size_t ignore = EntityManager::InvalidIndex; // Usually the asker
+
+    static QueryFilter Type(int typeID) {
+        QueryFilter f;
+        int t = GetDenseType(typeID);
+        f.types = (t >= 0 && t < 64) ? (1ull << t) : 0;
+        return f;
+    }
+    bool OnLayer(uint32_t layer) const {
+        return layers == ~0u || (layer & layers) != 0;
+    }
+    bool Accepts(int typeID) const {
+        if (types == ~0ull)
+            return true;
+        int t = GetDenseType(typeID);
+        return t >= 0 && t < 64 && ((types >> t) & 1);
+    }
+};
+
+struct QueryHit {
+    size_t index = EntityManager::InvalidIndex; // Entity row, or Invalid
+    int typeID = 0;                             // for a tile collider
+    Rectangle rect = {0, 0, 0, 0};
+};
+
+struct RayHit {
+    QueryHit hit;
+    float t = 1.0f;          // Fraction of the way from `from` to `to`
+    Vector2 point = {0, 0};  // Where the ray enters
+    Vector2 normal = {0, 0}; // Face it entered through, 0 if started inside
+};
+
+enum ContactPhase { CONTACT_BEGIN, CONTACT_STAY, CONTACT_END };
+
+// Two entities overlapping, a on the lower slot. An END may name an entity
+// that is already gone, so resolve the handles before using them.
+struct Contact {
+    EntityHandle a, b;
+    ContactPhase phase;
+};
+
 class CollisionSystem {
   public:
-    CollisionSystem() {
-        head.assign(COLS * ROWS, -1);
-        next.assign(7500, -1);
-    }
     static const int CELL_SIZE = 32;
-    static const int COLS = 128; // Adjust based on your world size
-    static const int ROWS = 128;
+    static const int CHUNK_CELLS = 4; // Spatial hash chunk side, in cells
+    static constexpr float CHUNK_SIZE = CELL_SIZE * CHUNK_CELLS;
+
+    // Moves faster than this fraction of a cell per tick are swept instead
+    // of stepped, so they can't skip over a one-tile wall
+    static constexpr float SweepFraction = 0.5f;
 
     void ResolveAll(EntityManager &em, float dt);
-    void ResetTileGrid();
+    // Refiles entities that moved into another chunk. ResolveAll does it
+    // too; call it after integrating so queries see this tick's positions.
+    void UpdateGrid(EntityManager &em);
+    // Wakes every sleeping body in or touching area, e.g. around tiles
+    // painted or erased since the last step
+    void WakeArea(EntityManager &em, Rectangle area);
+
+    // --- Spatial queries ---
+    // Tiles and entities matching the filter, written into the caller's
+    // buffer; each returns how many it wrote and never allocates. Tiles
+    // report their merged collider. Entities are found through the grid,
+    // which files them by center, so bodies wider than QueryMargin * 2 may
+    // be missed by a query that only grazes their edge. Not safe to run
+    // alongside UpdateGrid.
+    static constexpr float QueryMargin = CHUNK_SIZE * 0.5f;
+
+    // Everything overlapping area, in no set order; stops when out is full
+    size_t QueryAABB(const EntityManager &em, Rectangle area,
+                     const QueryFilter &filter, std::span<QueryHit> out) const;
+    // Everything overlapping the circle, in no set order
+    size_t QueryRadius(const EntityManager &em, Vector2 center, float radius,
+                       const QueryFilter &filter,
+                       std::span<QueryHit> out) const;
+    // Nearest hit along the segment
+    bool Raycast(const EntityManager &em, Vector2 from, Vector2 to,
+                 const QueryFilter &filter, RayHit &hit) const;
+    // The out.size() nearest hits along the segment, nearest first
+    size_t RaycastAll(const EntityManager &em, Vector2 from, Vector2 to,
+                      const QueryFilter &filter, std::span<RayHit> out) const;
+
+    // --- Contacts ---
+    // Entity-entity overlaps between layers that accept each other, diffed
+    // against the previous call into begin/stay/end events. Run it once per
+    // tick after ResolveAll so the rects are final. Entities at 0 health
+    // make no contacts.
+    void UpdateContacts(EntityManager &em);
+    std::span<const Contact> Contacts() const { return contacts; }
 
     void ResolveAxis(EntityManager &em, size_t i, bool isXAxis);
+    // Moves entity i by delta, stopping at the first tile it would enter and
+    // sliding along it with what is left. Sets grounded/walled like
+    // ResolveAxis does.
+    void SweptMove(EntityManager &em, size_t i, Vector2 delta);
+    // Fraction of delta box can travel before touching a tile on one of the
+    // mask's layers, 1 if none. On a hit, `hit` is the collider and `hitX`
+    // whether it was side-on.
+    float TimeOfImpact(Rectangle box, Vector2 delta, uint32_t mask,
+                       Rectangle &hit, bool &hitX) const;
+    // Headless tunneling check on the live em/tmap: fires `bodies` walkers
+    // at up to maxSpeed px/s inside a box of one-tile walls for two seconds
+    // of tickRate ticks. Returns how many ever ended a tick outside the box,
+    // SIZE_MAX if they could not be spawned. Clears the level either way.
+    size_t StressSweep(int bodies, float maxSpeed, float tickRate);
     CollisionResult CheckCollisionsInternal(EntityManager &em, size_t i,
                                             const Rectangle &sensorRect);
     CollisionResult CheckCollisions(EntityManager &em, Rectangle &sensorRect,
@@ -37,13 +147,73 @@ class CollisionSystem {
     bool LineIntersectsRect(Vector2 a, Vector2 b, Rectangle r);
 
   private:
-    std::vector<int> head;
-    std::vector<int> next;
-    std::vector<size_t> grid[COLS * ROWS];
-    std::vector<size_t> tileGrid[COLS * ROWS];
-    bool tileGridInitialized = false;
-
-    inline int GetGridIndex(float x, float y);
-    void BuildGrid(EntityManager &em);
+    // Dynamic entities hashed by chunk, stored as slots so compaction never
+    // invalidates them. Chunks exist only while something is in them, so
+    // memory follows the occupied area and coordinates are unbounded in
+    // both directions. An entity is only moved when its center crosses into
+    // another chunk; tiles live in the tilemap.
+    struct GridNode {
+        GridChunk *chunk = nullptr; // Chunk the slot is filed under
+        int cx = 0, cy = 0;         // That chunk's coordinates
+        int at = 0;                 // Position inside chunk->slots
+        uint32_t layer = 0;         // Layer it was counted under
+    };
+    std::unordered_map<uint64_t, GridChunk> chunks;
+    std::vector<GridNode> nodes; // Slot -> where it is filed
+    size_t emptyChunks = 0;      // Swept once they outnumber the rest
+
+    static uint64_t ChunkKey(int cx, int cy) {
+        return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+    }
+    static int ChunkOf(float w);
+    // Calls f(dense index) for every live entity filed in a chunk that area
+    // (grown by QueryMargin) touches, skipping chunks with nothing on
+    // `layers` unless that is ~0u
+    template <typename F>
+    void ForEachFiled(const EntityManager &em, Rectangle area,
+                      uint32_t layers, F f) const;
+    // Shared body of QueryAABB/QueryRadius: candidates in bounds that pass
+    // the filter and test(rect)
+    template <typename Test>
+    size_t Collect(const EntityManager &em, Rectangle bounds,
+                   const QueryFilter &filter, std::span<QueryHit> out,
+                   Test test) const;
+    // Contact broadphase. Bodies are grouped by layer. Two groups that can
+    // touch are paired by filing the smaller one in a throwaway grid and
+    // probing it with every body of the larger, so thousands of bullets
+    // cost one lookup each and are never tested against each other when
+    // their layer ignores itself. A layer that touches itself is sorted and
+    // swept on x instead.
+    struct ContactBody {
+        float x0, x1, y0, y1;
+        uint32_t slot, mask;
+    };
+    struct ContactGroup {
+        uint32_t layer = 0;
+        uint32_t masks = 0; // Union of the members' masks
+        float maxWidth = 0.0f, maxHeight = 0.0f;
+        std::vector<ContactBody> bodies;
+    };
+    struct ContactGrid {
+        float x = 0.0f, y = 0.0f, cell = 1.0f; // Origin and cell side
+        int w = 0, h = 0;
+        std::vector<uint32_t> start; // Cell -> first body, w * h + 1 long
+        std::vector<ContactBody> bodies;
+    };
+    std::vector<ContactGroup> contactGroups; // Kept to reuse the buffers
+    ContactGrid contactGrid;
+    std::vector<std::pair<EntityHandle, EntityHandle>> pairs, lastPairs;
+    // Lost pairs with a dormant side, carried into lastPairs unreported
+    std::vector<std::pair<EntityHandle, EntityHandle>> heldPairs;
+    std::vector<Contact> contacts;
+
+    void GatherContactBodies(EntityManager &em);
+    void FileContactGrid(const ContactGroup &g);
+    void PairGroups(const EntityManager &em, ContactGroup &g,
+                    ContactGroup &h);
+    void AddPair(const EntityManager &em, uint32_t a, uint32_t b);
+    void Insert(int slot, int cx, int cy, uint32_t layer);
+    void Erase(int slot);
+    void SweepChunks();
     void ResolveCollision(EntityManager &em, size_t i);
 };
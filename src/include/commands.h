@@ -0,0 +1,47 @@
+#pragma once
+
+#include "entities.h"
+#include "raylib.h"
+#include <cstdint>
+#include <vector>
+
+// Structural changes (spawns, removals) and component writes that must not
+// happen while a system is iterating the SoA. Every thread records into its
+// own buffer; FlushCommands() applies all of them in one ordered pass at the
+// end of the tick.
+enum CommandType {
+    CMD_SPAWN,
+    CMD_DESTROY,
+    CMD_SET_POS,
+    CMD_SET_VEL,
+    CMD_SET_HEALTH
+};
+
+struct EntityCommand {
+    CommandType type;
+    uint64_t order; // Global record order, keeps the flush deterministic
+
+    EntityHandle target;  // DESTROY / SET_*
+    int typeID = 0;       // SPAWN
+    Vector2 vec = {0, 0}; // SPAWN position, SET_POS, SET_VEL
+    float value = 0.0f;   // SET_HEALTH
+};
+
+struct CommandBuffer {
+    std::vector<EntityCommand> commands;
+
+    void Spawn(int typeID, Vector2 pos);
+    void Destroy(EntityHandle h);
+    void SetPos(EntityHandle h, Vector2 pos);
+    void SetVel(EntityHandle h, Vector2 vel);
+    void SetHealth(EntityHandle h, float health);
+
+  private:
+    EntityCommand &Record(CommandType type, EntityHandle h);
+};
+
+// The calling thread's buffer, registered for flushing on first use
+CommandBuffer &Commands();
+
+void FlushCommands(EntityManager &em);
+void DiscardCommands();
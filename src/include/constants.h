@@ -29,6 +29,7 @@ enum KEYS {
 
     KEY_SAVE = KEY_K,
     KEY_LOAD = KEY_L,
+    KEY_STREAM = KEY_O,
 
     KEY_MOVE_UP = KEY_RIGHT_SHIFT,
     KEY_MOVE_DOWN = KEY_DOWN,
@@ -45,3 +46,8 @@ enum KEYS {
 const float GRID_SIZE = 32.0f;
 const int MAP_WIDTH_UNITS = 2500;
 const int MAP_HEIGHT_UNITS = 2500;
+
+// The simulation steps at a fixed rate regardless of the render rate
+const float DEFAULT_TICK_RATE = 60.0f;
+// Rate the per-tick tuning values (gravity, ACEL, damping) were authored at
+const float TUNING_RATE = 60.0f;
@@ -2,10 +2,14 @@
 
 #include "assets.h"
 #include "raylib.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <fstream>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 using json = nlohmann::json;
@@ -28,6 +32,15 @@ inline void from_json(const nlohmann::json &j, Color &c) {
 inline std::unordered_map<std::string, int> EntityRegistry; // Name -> ID
 inline std::unordered_map<int, std::string> IdToName;       // ID -> Name
 
+// Registry IDs are sparse (1, 1500, 1750...); dense IDs index per-type tables
+inline std::vector<int> DenseToType;            // Dense ID -> ID
+inline std::unordered_map<int, int> TypeToDense; // ID -> Dense ID
+
+inline int GetDenseType(int typeID) {
+    auto it = TypeToDense.find(typeID);
+    return (it != TypeToDense.end()) ? it->second : -1;
+}
+
 inline int GetTypeID(
     const std::string &name) { // Use const reference to avoid string copying
     auto it = EntityRegistry.find(name);
@@ -69,8 +82,176 @@ inline void LoadTypes() {
     EntityTys::TYMOD_START = 10000;
 }
 
+// Collision layers. Every type sits on some layers and collides with the
+// layers in its mask, both set per type in entities.json by name. Two
+// entities touch only when each one's mask names a layer of the other; an
+// entity meets a tile when its mask names the tile type's layer.
+namespace Layer {
+enum : uint32_t {
+    PLAYER = 1u << 0,
+    ENEMY = 1u << 1,
+    ATTACK = 1u << 2,     // Damage volumes (HITBOX)
+    TARGET = 1u << 3,     // Things that can be hit but don't move (HURTBOX)
+    PROJECTILE = 1u << 4, // BULLET
+    HAZARD = 1u << 5,
+    TILE = 1u << 6,    // Solid tiles
+    ONE_WAY = 1u << 7, // One-way platforms
+
+    DAMAGEABLE = PLAYER | ENEMY | TARGET, // Take DAMAGE from what they touch
+};
+
+inline constexpr std::pair<const char *, uint32_t> Names[] = {
+    {"PLAYER", PLAYER}, {"ENEMY", ENEMY},           {"ATTACK", ATTACK},
+    {"TARGET", TARGET}, {"PROJECTILE", PROJECTILE}, {"HAZARD", HAZARD},
+    {"TILE", TILE},     {"ONE_WAY", ONE_WAY},
+};
+
+// ["ENEMY", "TILE"] -> bits; a plain number is taken as the bits themselves
+inline uint32_t Parse(const nlohmann::json &j) {
+    if (j.is_number_unsigned())
+        return j.get<uint32_t>();
+
+    uint32_t bits = 0;
+    if (!j.is_array())
+        return bits;
+    for (const auto &name : j) {
+        if (!name.is_string())
+            continue;
+        bool known = false;
+        for (auto const &[n, bit] : Names) {
+            if (name.get<std::string>() == n) {
+                bits |= bit;
+                known = true;
+            }
+        }
+        if (!known)
+            TraceLog(LOG_WARNING, "CONFIG: Unknown layer [%s]",
+                     name.get<std::string>().c_str());
+    }
+    return bits;
+}
+} // namespace Layer
+
+// One bit per entity packed 64 to a word. Unlike std::vector<bool> this
+// exposes the words, so counts and multi-flag filters (e.g. grounded & ~walled)
+// run 64 entities per instruction. Bits past size() are always zero.
+// Writers on different words never race; parallel loops must split on
+// 64-entity boundaries.
+struct BitColumn {
+    std::vector<uint64_t> words;
+    size_t count = 0;
+
+    size_t size() const { return count; }
+    size_t WordCount() const { return words.size(); }
+
+    void reserve(size_t capacity) { words.reserve((capacity + 63) / 64); }
+    void clear() {
+        words.clear();
+        count = 0;
+    }
+    // Resizes to n bits, all clear
+    void reset(size_t n) {
+        words.assign((n + 63) / 64, 0);
+        count = n;
+    }
+
+    bool operator[](size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+
+    void set(size_t i, bool value) {
+        uint64_t bit = uint64_t{1} << (i & 63);
+        if (value)
+            words[i >> 6] |= bit;
+        else
+            words[i >> 6] &= ~bit;
+    }
+
+    void push_back(bool value) {
+        if ((count & 63) == 0)
+            words.push_back(0);
+        set(count++, value);
+    }
+
+    // Appends n bits of `value`, filling whole words where it can
+    void append(size_t n, bool value) {
+        size_t end = count + n;
+        words.resize((end + 63) / 64, 0);
+        if (value) {
+            size_t i = count;
+            for (; i < end && (i & 63); ++i)
+                set(i, true);
+            for (; i + 64 <= end; i += 64)
+                words[i >> 6] = ~uint64_t{0};
+            for (; i < end; ++i)
+                set(i, true);
+        }
+        count = end;
+    }
+
+    void pop_back() {
+        set(--count, false);
+        if ((count & 63) == 0)
+            words.pop_back();
+    }
+
+    size_t Count() const {
+        size_t n = 0;
+        for (uint64_t w : words)
+            n += std::popcount(w);
+        return n;
+    }
+};
+
+// Calls f(i) for every set bit of the mask built by word(w), e.g.
+// [&](size_t w) { return grounded.words[w] & ~walled.words[w]; }
+// The ranged form visits words [wBegin, wEnd) only, for splitting work.
+template <typename WordFn, typename F>
+inline void ForEachBit(size_t wBegin, size_t wEnd, WordFn word, F f) {
+    for (size_t w = wBegin; w < wEnd; ++w) {
+        uint64_t bits = word(w);
+        while (bits) {
+            f((w << 6) + std::countr_zero(bits));
+            bits &= bits - 1;
+        }
+    }
+}
+
+template <typename WordFn, typename F>
+inline void ForEachBit(size_t wordCount, WordFn word, F f) {
+    ForEachBit(0, wordCount, word, f);
+}
+
+// Calls f(i) for every entity whose bit is set in `col`
+template <typename F> inline void ForEachSet(const BitColumn &col, F f) {
+    ForEachBit(
+        col.WordCount(), [&](size_t w) { return col.words[w]; }, f);
+}
+
+// Swap-removes every index in `sorted` (descending, unique) from one column.
+// Working high to low means the tail element swapped in is never pending.
+template <typename T>
+inline void SwapRemoveBatch(std::vector<T> &col,
+                            const std::vector<size_t> &sorted) {
+    for (size_t index : sorted) {
+        size_t last = col.size() - 1;
+        if (index < last)
+            col[index] = std::move(col[last]);
+        col.pop_back();
+    }
+}
+
+inline void SwapRemoveBatch(BitColumn &col,
+                            const std::vector<size_t> &sorted) {
+    for (size_t index : sorted) {
+        size_t last = col.size() - 1;
+        if (index < last)
+            col.set(index, col[last]);
+        col.pop_back();
+    }
+}
+
 struct PhysicsComponent {
     std::vector<Vector2> pos;
+    std::vector<Vector2> prevPos; // pos at the start of the current tick
     std::vector<Vector2> vel;
     std::vector<Vector2> siz;
     std::vector<Vector2> scale;
@@ -79,13 +260,20 @@ struct PhysicsComponent {
     std::vector<Rectangle> rectY;
     std::vector<float> mass;
     std::vector<float> gravity;
-    std::vector<bool> active;
-    std::vector<bool> initialized;
-    std::vector<bool> collide;
-    std::vector<bool> grounded, walled;
+    std::vector<uint32_t> layer;    // Layer bits it sits on
+    std::vector<uint32_t> mask;     // Layer bits it collides with
+    std::vector<uint8_t> restTicks; // Steps in a row it ended where it began
+    BitColumn active;
+    BitColumn initialized;
+    BitColumn collide;
+    BitColumn grounded, walled;
+    BitColumn sleeping; // At rest; skipped by the physics step until woken
+    BitColumn dormant;  // Past its type's LOD far ring; not simulated at all
+    BitColumn reduced;  // Past its type's LOD near ring; behaviours slowed
 
     void Reserve(size_t capacity) {
         pos.reserve(capacity);
+        prevPos.reserve(capacity);
         vel.reserve(capacity);
         siz.reserve(capacity);
         scale.reserve(capacity);
@@ -94,63 +282,66 @@ struct PhysicsComponent {
         rectY.reserve(capacity);
         mass.reserve(capacity);
         gravity.reserve(capacity);
+        layer.reserve(capacity);
+        mask.reserve(capacity);
+        restTicks.reserve(capacity);
         active.reserve(capacity);
         initialized.reserve(capacity);
         collide.reserve(capacity);
         grounded.reserve(capacity);
         walled.reserve(capacity);
+        sleeping.reserve(capacity);
+        dormant.reserve(capacity);
+        reduced.reserve(capacity);
     }
 
     void Clear() {
         pos.clear();
+        prevPos.clear();
         vel.clear();
         scale.clear();
         siz.clear();
         rect.clear();
         rectX.clear();
         rectY.clear();
+        mass.clear();
         gravity.clear();
+        layer.clear();
+        mask.clear();
+        restTicks.clear();
         active.clear();
         initialized.clear();
         collide.clear();
         grounded.clear();
         walled.clear();
+        sleeping.clear();
+        dormant.clear();
+        reduced.clear();
     }
 
-    void Remove(size_t index) {
-        size_t last = pos.size() - 1;
-
-        // Only swap if the element we are removing is NOT the last one
-        if (index < last) {
-            pos[index] = pos[last];
-            vel[index] = vel[last];
-            siz[index] = siz[last];
-            scale[index] = scale[last];
-            rect[index] = rect[last];
-            rectX[index] = rectX[last];
-            rectY[index] = rectY[last];
-            gravity[index] = gravity[last];
-            active[index] = active[last];
-            initialized[index] = initialized[last];
-            collide[index] = collide[last];
-            grounded[index] = grounded[last];
-            walled[index] = walled[last];
-        }
-
-        // Ridiculous Speed: Pop all vectors to keep them perfectly aligned
-        pos.pop_back();
-        vel.pop_back();
-        siz.pop_back();
-        scale.pop_back();
-        rect.pop_back();
-        rectX.pop_back();
-        rectY.pop_back();
-        gravity.pop_back();
-        active.pop_back();
-        initialized.pop_back();
-        collide.pop_back();
-        grounded.pop_back();
-        walled.pop_back();
+    void RemoveBatch(const std::vector<size_t> &sorted) {
+        // One pass per column keeps each vector hot while it is compacted
+        SwapRemoveBatch(pos, sorted);
+        SwapRemoveBatch(prevPos, sorted);
+        SwapRemoveBatch(vel, sorted);
+        SwapRemoveBatch(siz, sorted);
+        SwapRemoveBatch(scale, sorted);
+        SwapRemoveBatch(rect, sorted);
+        SwapRemoveBatch(rectX, sorted);
+        SwapRemoveBatch(rectY, sorted);
+        SwapRemoveBatch(mass, sorted);
+        SwapRemoveBatch(gravity, sorted);
+        SwapRemoveBatch(layer, sorted);
+        SwapRemoveBatch(mask, sorted);
+        SwapRemoveBatch(restTicks, sorted);
+        SwapRemoveBatch(active, sorted);
+        SwapRemoveBatch(initialized, sorted);
+        SwapRemoveBatch(collide, sorted);
+        SwapRemoveBatch(grounded, sorted);
+        SwapRemoveBatch(walled, sorted);
+        SwapRemoveBatch(sleeping, sorted);
+        SwapRemoveBatch(dormant, sorted);
+        SwapRemoveBatch(reduced, sorted);
     }
 };
 
@@ -161,7 +352,7 @@ struct RenderComponent {
     std::vector<Texture2D> texture;
     std::vector<float> rotation;
 
-    std::vector<bool> texDraw;
+    BitColumn texDraw;
     std::vector<int> frameNum, rowIndex;
     std::vector<int> frameMin, frameMax;
     std::vector<float> frameSpd;
@@ -192,33 +383,17 @@ struct RenderComponent {
         frameMax.clear();
     }
 
-    void Remove(size_t index) {
-        size_t last = typeID.size() - 1;
-
-        // Only swap if the element we are removing is NOT the last one
-        if (index < last) {
-            typeID[index] = typeID[last];
-            varID[index] = varID[last];
-            col[index] = col[last];
-            rotation[index] = rotation[last];
-            texDraw[index] = texDraw[last];
-            frameNum[index] = frameNum[last];
-            rowIndex[index] = rowIndex[last];
-            frameSpd[index] = frameSpd[last];
-            frameMin[index] = frameMin[last];
-            frameMax[index] = frameMax[last];
-        }
-
-        typeID.pop_back();
-        varID.pop_back();
-        col.pop_back();
-        rotation.pop_back();
-        texDraw.pop_back();
-        frameNum.pop_back();
-        rowIndex.pop_back();
-        frameSpd.pop_back();
-        frameMin.pop_back();
-        frameMax.pop_back();
+    void RemoveBatch(const std::vector<size_t> &sorted) {
+        SwapRemoveBatch(typeID, sorted);
+        SwapRemoveBatch(varID, sorted);
+        SwapRemoveBatch(col, sorted);
+        SwapRemoveBatch(rotation, sorted);
+        SwapRemoveBatch(texDraw, sorted);
+        SwapRemoveBatch(frameNum, sorted);
+        SwapRemoveBatch(rowIndex, sorted);
+        SwapRemoveBatch(frameSpd, sorted);
+        SwapRemoveBatch(frameMin, sorted);
+        SwapRemoveBatch(frameMax, sorted);
     }
 };
 
@@ -236,24 +411,73 @@ struct StatsComponent {
         maxHealth.clear();
     }
 
-    void Remove(size_t index) {
-        size_t last = health.size() - 1;
+    void RemoveBatch(const std::vector<size_t> &sorted) {
+        SwapRemoveBatch(health, sorted);
+        SwapRemoveBatch(maxHealth, sorted);
+    }
+};
 
-        // Only swap if the element we are removing is NOT the last one
-        if (index < last) {
-            health[index] = health[last];
-            maxHealth[index] = maxHealth[last];
-        }
+// --- Entity Variables ---
+// Every var name maps to a global slot. Engine vars get fixed slots at
+// compile time (Var::COYOTE_TIME etc.), anything else from entities.json or a
+// level file is interned after them when it is first loaded.
+#define ENGINE_VARS(X)                                                         \
+    X(LOCK_TIME) X(ACEL) X(DCEL) X(MAX_SPEED) X(GRAV) X(GRAV_A) X(GRAV_N)      \
+    X(GRAV_M) X(JUMP_VAR) X(DASH_VAR) X(TRICK_TYPE) X(TRICK_METER)             \
+    X(TRICK_METER_MAX) X(TRICK_START_VEL) X(TRICK_DIR) X(CAN_JUMP)             \
+    X(CAN_WALL_JUMP) X(CAN_DASH) X(HAS_WALL_JUMPED) X(HAS_DASHED)              \
+    X(COYOTE_TIME) X(COYOTE_MAX) X(JUMP_BUFFER) X(JUMP_BUFFER_MAX)             \
+    X(DASH_COOLDOWN) X(DASH_DURATION) X(SCALE_TWEEN_TIME)                      \
+    X(SCALE_TWEEN_DURATION) X(SCALE_START_VAL) X(WAS_IN_AIR) X(AIR_TIME)       \
+    X(IS_SPINNING) X(WAS_ON_WALL) X(IS_GROUNDED) X(FLASH_TIME)                 \
+    X(WALL_KICK_TIME) X(WALL_KICK_SIDE) X(DAMAGE)
+
+namespace Var {
+#define X(name) name,
+enum Id : uint16_t { ENGINE_VARS(X) ENGINE_COUNT };
+#undef X
+
+#define X(name) #name,
+inline constexpr const char *EngineNames[ENGINE_COUNT] = {ENGINE_VARS(X)};
+#undef X
+} // namespace Var
+
+struct VarRegistry {
+    std::unordered_map<std::string, uint16_t> slots; // Name -> slot
+    std::vector<std::string> names;                  // Slot -> name
+
+    VarRegistry() {
+        for (const char *name : Var::EngineNames)
+            Intern(name);
+    }
 
-        health.pop_back();
-        maxHealth.pop_back();
+    uint16_t Intern(const std::string &name) {
+        auto it = slots.find(name);
+        if (it != slots.end())
+            return it->second;
+
+        uint16_t slot = names.size();
+        slots.emplace(name, slot);
+        names.push_back(name);
+        return slot;
+    }
+
+    int Find(const std::string &name) const {
+        auto it = slots.find(name);
+        return (it != slots.end()) ? it->second : -1;
     }
+
+    size_t Count() const { return names.size(); }
 };
 
+inline VarRegistry VarSlots;
+
 struct EntityConfig {
     Vector2 size = {32, 32};
     float gravity = 20.0f;
-    bool canCollide = true;
+    bool canCollide = true; // Mask names a tile layer; set by LoadConfigs
+    uint32_t layer = 0;
+    uint32_t mask = Layer::TILE | Layer::ONE_WAY;
 
     int vID = 0.0f;
     int tID = 0.0f;
@@ -270,9 +494,19 @@ struct EntityConfig {
     float health = 100.0f;
     float maxHealth = 100.0f;
 
+    // Simulation LOD by distance from the focus on either axis, off while
+    // lodFar is 0: behaviours run every lodRate ticks past lodNear, and
+    // nothing runs past lodFar
+    float lodNear = 0.0f, lodFar = 0.0f;
+    int lodRate = 1;
+
     std::map<std::string, float> customVars;
     std::map<std::string, float> customBehs;
 
+    // customVars resolved to slots, copied into every new entity
+    std::vector<std::pair<uint16_t, float>> varLayout;
+    uint32_t behMask = 0; // customBehs compiled to BehaveId bits
+
     void from_json(const nlohmann::json &j) {
         // Physics
         if (j.contains("size") && j["size"].is_array() &&
@@ -281,7 +515,14 @@ struct EntityConfig {
             size.y = j["size"][1].get<float>();
         }
 
+        // Layers. Without a mask, "collide" picks between tiles or nothing
         canCollide = j.value("collide", true);
+        if (j.contains("layer"))
+            layer = Layer::Parse(j["layer"]);
+        if (j.contains("mask"))
+            mask = Layer::Parse(j["mask"]);
+        else if (!canCollide)
+            mask = 0;
 
         if (j.contains("gravity") && j["gravity"].is_number()) {
             gravity = j["gravity"].get<float>();
@@ -326,6 +567,14 @@ struct EntityConfig {
         maxHealth = j.value("maxHealth",
                             health); // Match max to current if not specified
 
+        // Level of detail
+        if (j.contains("lod") && j["lod"].is_object()) {
+            const nlohmann::json &lod = j["lod"];
+            lodFar = std::max(lod.value("far", 0.0f), 0.0f);
+            lodNear = std::clamp(lod.value("near", lodFar), 0.0f, lodFar);
+            lodRate = std::max(lod.value("rate", 1), 1);
+        }
+
         // Variables
         if (j.contains("customVars") && j["customVars"].is_object()) {
             for (auto &[key, value] : j["customVars"].items()) {
@@ -345,40 +594,73 @@ struct EntityConfig {
     }
 };
 
+// Flat per-entity var storage indexed by VarRegistry slot. The slot
+// overloads are the per-frame path; the string ones are for JSON and the
+// editor and intern unknown names on write.
 struct EntityVars {
-    std::unordered_map<std::string, float> values;
+    std::vector<float> values;
+    std::vector<uint64_t> present; // One bit per slot, backs has() and saving
 
-    bool has(const std::string &name) {
-        return values.find(name) != values.end();
+    bool has(uint16_t slot) const {
+        return (slot >> 6) < present.size() &&
+               ((present[slot >> 6] >> (slot & 63)) & 1);
     }
 
-    float get(const std::string &key, float defaultVal = 0.0f) {
-        auto it = values.find(key);
-        return (it != values.end()) ? it->second : defaultVal;
+    float get(uint16_t slot, float defaultVal = 0.0f) const {
+        return has(slot) ? values[slot] : defaultVal;
     }
 
-    void set(const std::string &key, float value) { values[key] = value; }
+    void set(uint16_t slot, float value) {
+        if (slot >= values.size()) {
+            values.resize(slot + 1, 0.0f);
+            present.resize((slot >> 6) + 1, 0);
+        }
+        values[slot] = value;
+        present[slot >> 6] |= uint64_t{1} << (slot & 63);
+    }
 
-    void add(const std::string &key, float value) { values[key] += value; }
+    void add(uint16_t slot, float value) { set(slot, get(slot) + value); }
 
-    void sub(const std::string &key, float value) { values[key] -= value; }
+    void sub(uint16_t slot, float value) { set(slot, get(slot) - value); }
 
-    void mul(const std::string &key, float value) { values[key] *= value; }
+    void mul(uint16_t slot, float value) { set(slot, get(slot) * value); }
 
-    void div(const std::string &key, float value) { values[key] /= value; }
-};
+    void div(uint16_t slot, float value) { set(slot, get(slot) / value); }
 
-struct EntityBehaves {
-    std::unordered_map<std::string, float> values;
+    // --- String fallback ---
+    bool has(const std::string &name) const {
+        int slot = VarSlots.Find(name);
+        return slot >= 0 && has((uint16_t)slot);
+    }
 
-    bool has(const std::string &name) {
-        return values.find(name) != values.end();
+    float get(const std::string &key, float defaultVal = 0.0f) const {
+        int slot = VarSlots.Find(key);
+        return (slot >= 0) ? get((uint16_t)slot, defaultVal) : defaultVal;
     }
 
-    float get(const std::string &key, float defaultVal = 0.0f) {
-        auto it = values.find(key);
-        return (it != values.end()) ? it->second : defaultVal;
+    void set(const std::string &key, float value) {
+        set(VarSlots.Intern(key), value);
     }
 
-    void set(const std::string &key, float value) { values[key] = value; }
+    // Calls f(name, value) for every var this entity has set
+    template <typename F> void ForEach(F f) const {
+        for (size_t slot = 0; slot < values.size(); ++slot) {
+            if (has(slot))
+                f(VarSlots.names[slot], values[slot]);
+        }
+    }
+};
+
+// Compiled behavior bits (see BehaveId), seeded from the entity's type
+struct EntityBehaves {
+    uint32_t mask = 0;
+
+    bool has(int behave) const { return (mask >> behave) & 1; }
+
+    void set(int behave, bool on) {
+        if (on)
+            mask |= 1u << behave;
+        else
+            mask &= ~(1u << behave);
+    }
 };
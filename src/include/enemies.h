@@ -5,5 +5,5 @@
 #include "raylib.h"
 #include <cstddef>
 
-void EnemySystem(EntityManager &em, size_t i);
+void EnemySystem(EntityManager &em, size_t i, float dt);
 void EnemyDrawing(EntityManager &em, size_t i);
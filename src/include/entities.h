@@ -7,9 +7,22 @@
 #include <filesystem>
 #include <fstream>
 #include <map>
+#include <span>
 #include <string>
 #include <vector>
 
+// Stable reference to an entity. Dense indices move on every swap-remove, a
+// handle does not; once its entity is removed the generation no longer
+// matches and Resolve() fails instead of aliasing whatever took the slot.
+struct EntityHandle {
+    uint32_t index = UINT32_MAX; // Slot in EntityManager::sparse
+    uint32_t generation = 0;
+
+    bool operator==(const EntityHandle &) const = default;
+};
+
+inline constexpr EntityHandle NullHandle{};
+
 struct EntityManager {
     PhysicsComponent physics;
     RenderComponent rendering;
@@ -19,24 +32,141 @@ struct EntityManager {
     std::vector<EntityBehaves> behs;
 
     std::unordered_map<std::string, EntityConfig> ConfigMap;
+    std::vector<const EntityConfig *> typeConfigs; // Dense type ID -> config
+    std::vector<uint32_t> typeBehaves; // Dense type ID -> behavior mask
+
+    // --- Handles (sparse slot <-> dense index) ---
+    static constexpr size_t InvalidIndex = SIZE_MAX;
+    static constexpr uint32_t InvalidSlot = UINT32_MAX;
+
+    std::vector<uint32_t> sparse;      // Slot -> dense index
+    std::vector<uint32_t> generations; // Slot -> live generation
+    std::vector<uint32_t> dense;       // Dense index -> slot, or InvalidSlot
+    std::vector<uint32_t> freeSlots;
+
+    // --- Tombstones ---
+    // Removed rows stay in the columns with active cleared until a spawn
+    // refills them or Compact() squeezes them out. Anything walking raw rows
+    // must skip inactive ones; ForEachSet(physics.active) already does.
+    static constexpr float CompactRatio = 0.25f; // Of all rows
+    static constexpr size_t CompactMinRows = 256;
+    std::vector<size_t> freeRows;
+
+    // --- Type buckets ---
+    // Slots of every entity per dense type ID, kept up to date on add/remove
+    // so systems only visit their own entities. Slots rather than dense
+    // indices, so swap-removes never have to touch them.
+    std::vector<std::vector<uint32_t>> typeBuckets;
+    std::vector<uint32_t> bucketPos; // Slot -> position in its bucket
 
     void Reserve(size_t capacity);
-    size_t AddEntity(int typeID, int varID, Vector2 pos, Vector2 siz,
-                     float gravity, Color col);
-    size_t AddEntityJ(std::string typeName, Vector2 pos);
+    EntityHandle AddEntity(int typeID, int varID, Vector2 pos, Vector2 siz,
+                           float gravity, Color col);
+    EntityHandle AddEntityJ(std::string typeName, Vector2 pos);
+    // Spawns one entity of typeID per position with the config resolved once,
+    // refilling tombstoned rows first and growing every column once for the
+    // rest. `indices` (optional) receives the dense index of each spawn in
+    // order. Returns false when the type is unknown or a tile type (painted
+    // into the tilemap instead).
+    bool SpawnBatch(int typeID, std::span<const Vector2> positions,
+                    std::vector<size_t> *indices = nullptr);
     void LoadConfigs(const std::string &path);
 
+    // Fraction of a tick the renderer is past the last simulated state, set
+    // by the game loop; drawing lerps prevPos -> pos by it
+    float renderAlpha = 1.0f;
+
+    void SnapshotPositions(); // prevPos = pos, at the start of every tick
+    Vector2 RenderPos(size_t i) const {
+        const Vector2 &a = physics.prevPos[i], &b = physics.pos[i];
+        return {a.x + (b.x - a.x) * renderAlpha,
+                a.y + (b.y - a.y) * renderAlpha};
+    }
+
     void UpdateAll(float dt);
+    // Replays `frames` integration ticks from the current state on two
+    // copies, one serial and one parallel, and reports whether they agree
+    // bit for bit. Leaves this manager untouched.
+    bool CheckDeterminism(int frames, float dt) const;
     void DrawAll(Camera2D camera);
 
+    // --- Sleeping ---
+    // A body that ends SleepTicks steps in a row where it began, with no
+    // sideways velocity, is put to sleep: its velocity is zeroed and the
+    // physics step, grid update and tile resolution skip it. Writing a
+    // non-zero velocity (behaviours, input, commands) wakes it on the next
+    // step by itself; anything else that should move it calls Wake.
+    static constexpr uint8_t SleepTicks = 30;
+    void Wake(size_t i) {
+        physics.sleeping.set(i, false);
+        physics.restTicks[i] = 0;
+    }
+    // Word w of the rows the physics step visits, for ForEachBit
+    uint64_t AwakeWord(size_t w) const {
+        return physics.active.words[w] &
+               ~(physics.sleeping.words[w] | physics.dormant.words[w]);
+    }
+
+    // --- Level of detail ---
+    // Types with a "lod" block in their config are simulated by how far
+    // they are from a focus point, on either axis: fully within lodNear,
+    // with behaviours every lodRate ticks out to lodFar, and not at all
+    // past it. Dormant rows keep their velocity and their place in the
+    // grid and contacts, and carry on once back in range. Physics still runs
+    // every tick in the middle ring, so nothing falls through the level.
+    //
+    // UpdateLod re-rings one LodSlices-th of each type per call and counts
+    // the ticks the middle ring is staggered by; call it once per tick,
+    // before anything reads the rings. Until it's called, nothing is LOD'd.
+    static constexpr uint32_t LodSlices = 8;
+    uint32_t lodTick = 0;
+    void UpdateLod(Vector2 focus);
+
+    EntityHandle GetHandle(size_t i) const;
+    bool IsValid(EntityHandle h) const;
+    size_t Resolve(EntityHandle h) const;
+
+    // Calls f(i) with the dense index of every entity of typeID
+    template <typename F> void ForEachOfType(int typeID, F f) const {
+        int t = GetDenseType(typeID);
+        if (t < 0)
+            return;
+        for (uint32_t slot : typeBuckets[t])
+            f((size_t)sparse[slot]);
+    }
+    void RebuildBuckets();
+
+    // Types with the "tile" behavior live in the tilemap, not the SoA
+    bool IsTileType(int typeID) const;
+
+    void Clear();
+    // Swap-removes every tombstoned row in one pass per column. Moves dense
+    // indices (never handles); RemoveBatch calls it past CompactRatio.
     void Compact();
-    void FastRemove(size_t index);
+    void Tombstone(size_t index); // RemoveBatch of one row
+    void RemoveBatch(std::vector<size_t> &indices);
+    void Remove(EntityHandle h);
     int GetActiveCount();
 
     void SyncRect(EntityManager &e, size_t i);
+
+  private:
+    bool SpawnRange(const EntityConfig &cfg,
+                    std::span<const Vector2> positions, std::span<size_t> out);
+    void WriteRow(size_t i, const EntityConfig &cfg, Vector2 pos);
+
+    static constexpr size_t IntegrateGrain = 16; // Words (1024 entities)
+
+    // Gravity, velocity and tile resolution for every active entity. Sets
+    // `dead` for entities whose health ran out instead of removing them.
+    void Integrate(float dt, bool parallel, BitColumn &dead);
+
+    EntityHandle AllocHandle(size_t denseIndex);
+    void BucketInsert(uint32_t slot, int typeID);
+    void BucketErase(uint32_t slot, int typeID);
 };
 
-void EntitySystem(EntityManager &em);
+void EntitySystem(EntityManager &em, float dt);
 void EntityDrawing(EntityManager &em);
 
 extern EntityManager em;
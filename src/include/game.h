@@ -45,13 +45,22 @@ class Game {
     Vector2 removeRectSize;
     Rectangle removeRect;
 
+    EntityHandle player; // Camera follow target
+
+    // --- Fixed timestep ---
+    static constexpr int MaxTicksPerFrame = 5;
+    float tickRate = DEFAULT_TICK_RATE; // Simulation ticks per second
+    float accumulator = 0.0f;           // Real time not yet simulated
+
     void Init();
     void Update(float dt);
     void Draw();
     void Unload();
 
     void ManageState();
-    void UpdateState(float dt);
+    void Tick(float dt);
+    void UpdateState(float dt); // Fixed-rate simulation
+    void UpdateFrame(float dt); // Per-frame camera, editor and UI
     void DrawState();
 
     void UpdateEntities(float dt);
@@ -0,0 +1,11 @@
+#pragma once
+
+// Raylib reports pressed/released edges for one rendered frame, but the
+// simulation ticks at its own rate, so a frame may run zero ticks or
+// several. Edges are latched every frame and seen by exactly one tick.
+// Held state (IsKeyDown) needs no latching.
+void LatchInput();   // Once per rendered frame, before ticking
+void ConsumeInput(); // After every tick
+
+bool TickKeyPressed(int key);
+bool TickKeyReleased(int key);
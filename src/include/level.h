@@ -1,6 +1,13 @@
+#pragma once
+
 #include "data.h"
 #include "entities.h"
+#include "levelfile.h"
+#include <future>
 #include <raymath.h>
+#include <span>
+#include <string>
+#include <vector>
 
 // Components
 struct WaveFunction {
@@ -22,10 +29,60 @@ struct WFCSystem {
     }
 };
 
+// Live rows and tiles copied out on the main thread, cheap enough to take
+// between frames. Names are left as var slots and BehaveId bits, and each
+// tile type's look is copied from its config, so turning them into level
+// columns and writing those can run on any thread without touching the
+// SoA, the configs or the var registry again.
+struct LevelSnapshot {
+    // Every live row and tile
+    void TakeAll();
+    // Only the given rows, by dense index
+    void Take(std::span<const size_t> indices);
+    // Only the tiles of TileChunk (cx, cy)
+    void TakeTiles(int cx, int cy);
+
+    // Adds the snapshot's rows and tiles to out, naming vars and behaviors
+    // in out's string table. Reads nothing but the snapshot.
+    void AppendTo(LevelColumns &out) const;
+    // Looks of the tile types taken, for the JSON writer
+    const TileLooks &Tiles() const { return tiles; }
+
+  private:
+    LevelColumns rows; // All but varName and behaves
+    TileLooks tiles;
+    std::vector<uint16_t> varSlot;      // Per var, alongside rows.varValue
+    std::vector<uint32_t> behaveMask;   // Per row
+    std::vector<std::string> slotNames; // VarSlots.names when taken
+
+    void AddRow(size_t i);
+    void AddTile(int x, int y, uint16_t type, uint8_t variant);
+};
+
 struct LevelManager {
     bool Save(const std::string &filename);
     bool Load(const std::string &filename);
     void Clear();
+    // Spawns a level, or a piece of one, on top of the SoA and tilemap.
+    // Colliders are left for the next bake.
+    void Spawn(const LevelView &level);
+
+    // --- Background saving ---
+    // Copies the level out on the calling thread and writes it on a worker,
+    // so a frame only pays for the copy. Returns false, saving nothing,
+    // while the previous save is still being written.
+    bool SaveAsync(const std::string &filename);
+
+    enum SaveState { IDLE, RUNNING, SAVED, FAILED };
+    // Where the last SaveAsync is; SAVED and FAILED are reported once, even
+    // when another save was started before anyone polled
+    SaveState PollSave();
+
+  private:
+    std::future<bool> saving;
+    SaveState finished = IDLE; // Collected from saving, not yet reported
+
+    void CollectSave(); // Moves a ready result out of saving into finished
 };
 
 extern LevelManager lm;
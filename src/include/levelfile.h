@@ -0,0 +1,193 @@
+#pragma once
+
+#include "raylib.h"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// --- Binary level format ---
+// Little-endian and laid out so a mapped file can be used in place:
+//
+//   LevelHeader
+//   LevelSection[sectionCount]
+//   one block per section, each starting on a 16 byte boundary
+//
+// Every section is one column of the entity or tile table, or part of the
+// string table that var and behavior names index into. Readers skip
+// section IDs they don't know, so new columns can be added without a
+// version bump; anything an old reader would get wrong bumps LevelVersion.
+inline constexpr uint32_t LevelMagic = 0x424C564C; // "LVLB"
+inline constexpr uint32_t LevelVersion = 1;
+inline constexpr size_t LevelAlign = 16;
+
+static_assert(std::endian::native == std::endian::little,
+              "Level columns are mapped as stored");
+
+struct LevelHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entityCount;
+    uint32_t tileCount;
+    uint32_t sectionCount;
+    uint32_t reserved;
+};
+
+struct LevelSection {
+    uint32_t id;       // LevelSectionId
+    uint32_t elemSize; // Bytes per element, checked against the reader's
+    uint64_t offset;   // From the start of the file
+    uint64_t count;    // Elements
+};
+
+enum LevelSectionId : uint32_t {
+    // Entities, entityCount rows each
+    SEC_TYPE_ID = 1,
+    SEC_VAR_ID,
+    SEC_POS,
+    SEC_SIZE,
+    SEC_GRAVITY,
+    SEC_COLOR,
+    SEC_HEALTH,
+    SEC_MAX_HEALTH,
+    SEC_BEHAVES,      // uint64 per row, bit n = SEC_BEHAVE_NAMES[n]
+    SEC_VAR_START,    // entityCount + 1 offsets into the var columns
+    SEC_VAR_NAME,     // String index per var
+    SEC_VAR_VALUE,
+    SEC_BEHAVE_NAMES, // String index per behavior bit, at most 64
+
+    // Tiles, tileCount rows each
+    SEC_TILE_X = 32,
+    SEC_TILE_Y,
+    SEC_TILE_TYPE,
+    SEC_TILE_VARIANT,
+
+    // Strings, back to back without terminators
+    SEC_STRING_START = 64, // String count + 1 offsets into the chars
+    SEC_STRING_CHARS,
+};
+
+// A level as columns, pointing either into a mapped file or into a
+// LevelColumns. Entities come sorted by type ID, so each type is one run
+// that spawns in one batch; tiles come sorted by row, then column.
+struct LevelView {
+    size_t entityCount = 0;
+    std::span<const int32_t> typeID, varID;
+    std::span<const Vector2> pos, siz;
+    std::span<const float> gravity, health, maxHealth;
+    std::span<const Color> col;
+    std::span<const uint64_t> behaves;
+    std::span<const uint32_t> varStart, varName;
+    std::span<const float> varValue;
+    std::span<const uint32_t> behaveNames;
+
+    size_t tileCount = 0;
+    std::span<const int32_t> tileX, tileY;
+    std::span<const uint16_t> tileType;
+    std::span<const uint8_t> tileVariant;
+
+    std::vector<std::string_view> strings;
+};
+
+// Owned columns, for levels read from JSON or captured from the SoA
+struct LevelColumns {
+    std::vector<int32_t> typeID, varID;
+    std::vector<Vector2> pos, siz;
+    std::vector<float> gravity, health, maxHealth;
+    std::vector<Color> col;
+    std::vector<uint64_t> behaves;
+    std::vector<uint32_t> varStart = {0}, varName;
+    std::vector<float> varValue;
+    std::vector<uint32_t> behaveNames;
+
+    std::vector<int32_t> tileX, tileY;
+    std::vector<uint16_t> tileType;
+    std::vector<uint8_t> tileVariant;
+
+    std::vector<std::string> strings;
+
+    // Index of name in strings, adding it on first use
+    uint32_t Intern(std::string_view name);
+    // Behavior bit for name, adding it to behaveNames on first use; -1 once
+    // all 64 are taken
+    int BehaveBit(std::string_view name);
+    // Stable-sorts entities by type ID and tiles by row, then column, as
+    // LevelView promises
+    void Sort();
+    // Drops every row but keeps the string table and behavior bits, so a
+    // level can be handed over in pieces that share names
+    void ClearRows();
+    // Adds level's rows and tiles after these, re-interning its names
+    void Append(const LevelView &level);
+
+    LevelView View() const;
+
+  private:
+    std::unordered_map<std::string, uint32_t> lookup; // Name -> index
+};
+
+// A binary level mapped read-only. The view points into the mapping and
+// is only valid while this object lives.
+struct MappedLevel {
+    MappedLevel() = default;
+    MappedLevel(const MappedLevel &) = delete;
+    MappedLevel &operator=(const MappedLevel &) = delete;
+    ~MappedLevel();
+
+    bool Open(const std::string &path);
+    const LevelView &View() const { return view; }
+
+  private:
+    void *base = nullptr;
+    size_t size = 0;
+    LevelView view;
+};
+
+// Whether path starts with LevelMagic; anything else is read as JSON
+bool IsBinaryLevel(const std::string &path);
+
+// What a JSON tile entry holds beyond the tile table, from the type's
+// config. Configs are rebuilt by a hot reload, so writers that may run off
+// the main thread are handed these instead of reading them.
+struct TileLook {
+    Color color = BLACK;
+    float health = 100.0f;
+    std::vector<std::string> behaves; // Behavior names
+};
+using TileLooks = std::unordered_map<uint16_t, TileLook>; // By type ID
+
+// Adds type's look from the loaded configs unless looks has it already.
+// Reads the configs, so main thread only.
+void LookUpTile(TileLooks &looks, uint16_t type);
+
+// JSON rows are split into entities and tiles by their type's config, so
+// the configs must be loaded first. The file is streamed through a SAX
+// parser, one entity object at a time, never held as a DOM.
+bool ReadLevelJson(const std::string &path, LevelColumns &out);
+// Same, but hands out to flush and empties it every time it holds `rows`
+// entities and tiles, so memory stays flat however big the file is.
+// Pieces come unsorted; whatever is left at the end stays in out.
+bool ReadLevelJson(const std::string &path, LevelColumns &out, size_t rows,
+                   const std::function<void(LevelColumns &)> &flush);
+// Tiles whose type isn't in tiles get a black, 100 health, plain entry
+bool WriteLevelJson(const std::string &path, const LevelView &level,
+                    const TileLooks &tiles);
+bool WriteLevelBinary(const std::string &path, const LevelView &level);
+
+// Either format into columns, sniffed by magic
+bool ReadLevel(const std::string &path, LevelColumns &out);
+// Writes JSON or binary, picked by extension as below, to a temp file that
+// is then renamed over path, so a crash or a full disk mid-write never
+// leaves a truncated level behind. tiles is only read for JSON.
+bool WriteLevel(const std::string &path, const LevelView &level,
+                const TileLooks &tiles);
+
+// Reads either format and writes the other one, or the same one again,
+// picked by the output's extension: .json, anything else is binary
+bool ConvertLevel(const std::string &from, const std::string &to);
+bool IsJsonPath(const std::string &path);
@@ -1,6 +1,10 @@
+#include "collision.h"
 #include "data.h"
 #include "entities.h"
 #include <cstddef>
+#include <span>
 
-void ObjectSystem(EntityManager &em, size_t i);
+void ObjectSystem(EntityManager &em, size_t i, float dt);
 void ObjectDrawing(EntityManager &em, size_t i);
+// Applies this tick's contact events: damage and spent bullets
+void ContactSystem(EntityManager &em, std::span<const Contact> contacts);
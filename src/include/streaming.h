@@ -0,0 +1,129 @@
+#pragma once
+
+#include "level.h"
+#include "levelfile.h"
+#include "raylib.h"
+#include "tiles.h"
+#include <bit>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Streams a level split into fixed square chunks around a point, so only
+// the part near the camera is in the SoA and tilemap. A chunk is one
+// TileChunk square and is kept as its own binary level file,
+// <dir>/<cx>_<cy>.lvl, holding its tiles and the entities whose center is
+// in it.
+//
+// Chunks within loadRadius of the point are read on a worker thread and
+// spawned once read; chunks past unloadRadius are copied out, removed and
+// written back on the same worker. The gap between the two radii is the
+// hysteresis: walking back and forth over a chunk border never reloads
+// anything. Reads and writes run in the order they were queued, so a chunk
+// is never read back before its last write lands.
+struct LevelStreamer {
+    static constexpr int CHUNK_CELLS = TileChunk::SIZE;
+    static constexpr float CHUNK_SIZE = CHUNK_CELLS * TileMap::TILE_SIZE;
+    // Updates between sweeps for entities that wandered out of every
+    // loaded chunk; those are written into the chunk they're in
+    static constexpr int StraySweep = 60;
+
+    int loadRadius = 2;   // Chunks each way, counted like a king's move
+    int unloadRadius = 3; // Kept above loadRadius
+
+    LevelStreamer() = default;
+    LevelStreamer(const LevelStreamer &) = delete;
+    LevelStreamer &operator=(const LevelStreamer &) = delete;
+    ~LevelStreamer() { Close(); }
+
+    // Replaces the current level with the chunks in dir, streamed in
+    // around the point passed to Update
+    bool Open(const std::string &dir);
+    // Writes every loaded chunk back, waits for the worker and leaves the
+    // level empty
+    void Close();
+    bool IsOpen() const { return !dir.empty(); }
+
+    // Queues reads for chunks that came into range, spawns the ones that
+    // finished and writes out the ones that left it. Adds and removes rows,
+    // so call it outside the tick.
+    void Update(Vector2 center);
+    // Queues a write of every loaded chunk without dropping any
+    void Flush();
+    // Blocks until every queued read and write is done, then spawns what
+    // was read
+    void Wait();
+
+    size_t LoadedChunks() const { return loaded; }
+    size_t QueuedJobs();
+
+    // Splits a level file into a chunk directory for Open, replacing any
+    // chunks already in it. Goes through the SoA, so it clears the level.
+    static bool Split(const std::string &level, const std::string &dir);
+
+  private:
+    enum JobKind : uint8_t {
+        NONE,
+        READ,  // File -> columns, handed back to Update
+        WRITE, // Snapshot replaces the file, which goes once empty
+        MERGE, // Snapshot is added to whatever the file already holds
+    };
+    struct Job {
+        JobKind kind;
+        int cx, cy;
+        uint32_t ticket = 0; // READ: matched against the chunk's on arrival
+        LevelSnapshot snap;  // WRITE, MERGE
+    };
+    struct Read {
+        int cx, cy;
+        uint32_t ticket;
+        LevelColumns level;
+    };
+    struct Chunk {
+        bool loaded = false; // Spawned, as opposed to waiting on its read
+        uint32_t ticket = 0;
+    };
+
+    std::string dir; // Empty while closed
+    std::unordered_map<uint64_t, Chunk> chunks; // Loaded or being read
+    size_t loaded = 0;
+    uint32_t nextTicket = 0;
+    int sinceSweep = 0;
+
+    std::thread worker;
+    std::mutex lock; // Guards everything below
+    std::condition_variable wake, idle;
+    std::deque<Job> jobs;
+    std::vector<Read> reads; // Finished, waiting for Update
+    size_t busy = 0;         // Queued or running
+    bool stopping = false;
+
+    static uint64_t Key(int cx, int cy) {
+        return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+    }
+    // Same squares as the tilemap's; a shift floors negative cells too
+    static_assert(std::has_single_bit((unsigned)CHUNK_CELLS));
+    static int ChunkOf(float w) {
+        return TileMap::CellOf(w) >> std::countr_zero((unsigned)CHUNK_CELLS);
+    }
+    static std::string ChunkPath(const std::string &dir, int cx, int cy);
+
+    // Copies out the rows and tiles of every chunk pick gives a job kind,
+    // one job per chunk (WRITE jobs even when empty, so the file follows).
+    // Removes them from the level when remove is set.
+    std::vector<Job> Capture(const std::function<JobKind(uint64_t)> &pick,
+                             bool remove);
+    void Queue(std::vector<Job> &batch);
+    void SpawnReads();
+    void Work();
+    // Does one job on whatever thread calls it; a READ fills read
+    static void Run(const std::string &dir, Job &job, LevelColumns *read);
+};
+
+extern LevelStreamer streamer;
@@ -1,6 +1,304 @@
 #pragma once
 
-#include "entities.h"
+#include "raylib.h"
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
 
-void TileSystem(EntityManager &em, size_t i);
\ No newline at end of file
+// Maximal rectangle of same-type solid cells, merged within one chunk
+struct TileCollider {
+    Rectangle rect; // World space
+    uint32_t layer; // The type's Layer bits, copied in at bake time
+    uint16_t type;
+    uint8_t x, y; // Top-left cell inside its chunk
+};
+
+// Fixed block of cells. Tiles store only what they need to be drawn and
+// collided with: a registry type ID and a variant per cell.
+struct TileChunk {
+    static constexpr int SIZE = 32; // Cells per side
+
+    uint16_t type[SIZE * SIZE] = {}; // Registry type ID, 0 = empty
+    uint8_t variant[SIZE * SIZE] = {};
+    int count = 0; // Occupied cells; the chunk is dropped once it hits 0
+
+    std::vector<TileCollider> colliders; // Rebuilt by TileMap::BakeColliders
+    uint16_t colliderOf[SIZE * SIZE] = {}; // Cell -> collider index + 1
+    uint32_t solid[SIZE] = {};             // Row -> bit per Layer::TILE cell
+    bool dirty = false;                    // Edited since the last bake
+};
+
+// Static level geometry, kept out of the entity SoA. Cells are GRID_SIZE
+// squares addressed by signed cell coordinates; chunks are allocated on
+// first write so sparse levels stay cheap. Reads never mutate, so any
+// thread may query while nobody is painting.
+struct TileMap {
+    static constexpr float TILE_SIZE = 32.0f; // Matches GRID_SIZE
+
+    std::unordered_map<uint64_t, TileChunk> chunks;
+
+    // World coordinate -> cell coordinate, floored so negatives work
+    static int CellOf(float w) {
+        float v = w * (1.0f / TILE_SIZE); // Exact, TILE_SIZE is a power of 2
+        int c = (int)v;
+        return c - (v < (float)c); // Floor without a libm call
+    }
+    // Last cell an edge at w still overlaps: one back when w is on a border
+    static int LastCellOf(float w) {
+        int c = CellOf(w);
+        return c - (c * TILE_SIZE == w);
+    }
+    static Rectangle CellRect(int x, int y) {
+        return {x * TILE_SIZE, y * TILE_SIZE, TILE_SIZE, TILE_SIZE};
+    }
+
+    uint16_t Get(int x, int y) const {
+        const TileChunk *c = FindChunk(x, y);
+        return c ? c->type[LocalIndex(x, y)] : 0;
+    }
+    uint8_t GetVariant(int x, int y) const {
+        const TileChunk *c = FindChunk(x, y);
+        return c ? c->variant[LocalIndex(x, y)] : 0;
+    }
+    bool IsSolid(int x, int y) const { return Get(x, y) != 0; }
+
+    void Set(int x, int y, uint16_t type, uint8_t variant = 0);
+    void Erase(int x, int y);
+    // Drops a whole chunk; bodies on it are woken by the next bake
+    void EraseChunk(int cx, int cy);
+    void Clear();
+    size_t Count() const { return tileCount; }
+
+    void Draw(Camera2D camera) const;
+
+    // Re-merges the colliders of every chunk edited since the last call.
+    // Collider queries never bake on their own, since physics reads them
+    // from several threads; run this after edits and before the next step.
+    // The area of every chunk edited (or dropped) goes into `edited`, so
+    // bodies asleep on it can be woken.
+    void BakeColliders(std::vector<Rectangle> *edited = nullptr);
+    // Marks every chunk for the next BakeColliders, e.g. after a config
+    // reload changed what layer a tile type is on
+    void InvalidateColliders();
+
+    // Calls f(const TileCollider &) once for every collider overlapping
+    // area, in cell order within each chunk
+    template <typename F> void ForEachCollider(Rectangle area, F f) const {
+        constexpr int S = TileChunk::SIZE;
+        int startX = CellOf(area.x), endX = CellOf(area.x + area.width);
+        int startY = CellOf(area.y), endY = CellOf(area.y + area.height);
+
+        for (int cy = startY >> 5; cy <= endY >> 5; ++cy) {
+            for (int cx = startX >> 5; cx <= endX >> 5; ++cx) {
+                const TileChunk *chunk = ChunkAt(cx, cy);
+                if (!chunk)
+                    continue;
+                const TileChunk &c = *chunk;
+
+                int x0 = std::max(startX - cx * S, 0);
+                int x1 = std::min(endX - cx * S, S - 1);
+                int y0 = std::max(startY - cy * S, 0);
+                int y1 = std::min(endY - cy * S, S - 1);
+
+                // A merged collider spans several cells, so it is only
+                // reported from the first one in scan order
+                for (int y = y0; y <= y1; ++y) {
+                    for (int x = x0; x <= x1; ++x) {
+                        uint16_t id = c.colliderOf[y * S + x];
+                        if (id == 0)
+                            continue;
+                        const TileCollider &col = c.colliders[id - 1];
+                        if (x != std::max<int>(col.x, x0) ||
+                            y != std::max<int>(col.y, y0))
+                            continue;
+                        if (Overlaps(area, col.rect))
+                            f(col);
+                    }
+                }
+            }
+        }
+    }
+
+    // Calls f(const TileCollider &) for every collider the segment passes
+    // through, in the order it reaches them, until f returns false. Walks
+    // the cells on the segment rather than everything in its bounds.
+    template <typename F>
+    void TraceSegment(Vector2 from, Vector2 to, F f) const {
+        int x = CellOf(from.x), y = CellOf(from.y);
+        int endX = CellOf(to.x), endY = CellOf(to.y);
+        float dx = to.x - from.x, dy = to.y - from.y;
+
+        // Fraction of the segment to the next vertical / horizontal cell
+        // edge, and per whole cell
+        int stepX = dx > 0 ? 1 : -1, stepY = dy > 0 ? 1 : -1;
+        float nextX = dx > 0 ? (x + 1) * TILE_SIZE : x * TILE_SIZE;
+        float nextY = dy > 0 ? (y + 1) * TILE_SIZE : y * TILE_SIZE;
+        float tMaxX = dx != 0 ? (nextX - from.x) / dx : INFINITY;
+        float tMaxY = dy != 0 ? (nextY - from.y) / dy : INFINITY;
+        float tDeltaX = dx != 0 ? TILE_SIZE / std::abs(dx) : INFINITY;
+        float tDeltaY = dy != 0 ? TILE_SIZE / std::abs(dy) : INFINITY;
+
+        const TileChunk *chunk = nullptr;
+        int chunkX = 0, chunkY = 0;
+        bool looked = false;
+        const TileCollider *last = nullptr;
+
+        int steps = std::abs(endX - x) + std::abs(endY - y);
+        for (int n = 0; n <= steps; ++n) {
+            if (!looked || (x >> 5) != chunkX || (y >> 5) != chunkY) {
+                chunkX = x >> 5;
+                chunkY = y >> 5;
+                chunk = FindChunk(x, y);
+                looked = true;
+            }
+
+            if (chunk) {
+                uint16_t id = chunk->colliderOf[LocalIndex(x, y)];
+                if (id != 0 && &chunk->colliders[id - 1] != last) {
+                    last = &chunk->colliders[id - 1];
+                    if (!f(*last))
+                        return;
+                }
+            }
+
+            if (tMaxX < tMaxY) {
+                x += stepX;
+                tMaxX += tDeltaX;
+            } else {
+                y += stepY;
+                tMaxY += tDeltaY;
+            }
+        }
+    }
+
+    // --- Solid probes ---
+    // Answered from the per-chunk solid bitmap: a run of cells is one mask
+    // per chunk row, so these cost a chunk lookup and a few bit ops instead
+    // of a collider walk. Only solid (Layer::TILE) tiles count, and a cell
+    // counts when it overlaps the area the way Overlaps() does.
+
+    // Whether any solid cell overlaps area
+    bool SolidIn(Rectangle area) const {
+        constexpr int S = TileChunk::SIZE;
+        int x0 = CellOf(area.x), x1 = LastCellOf(area.x + area.width);
+        int y0 = CellOf(area.y), y1 = LastCellOf(area.y + area.height);
+
+        for (int cy = y0 >> 5; cy <= y1 >> 5; ++cy) {
+            for (int cx = x0 >> 5; cx <= x1 >> 5; ++cx) {
+                const TileChunk *c = ChunkAt(cx, cy);
+                if (!c)
+                    continue;
+                int a = std::max(x0 - cx * S, 0);
+                int b = std::min(x1 - cx * S, S - 1);
+                uint32_t bits = (~0u >> (S - 1 - b)) & (~0u << a);
+                int r1 = std::min(y1 - cy * S, S - 1);
+                for (int r = std::max(y0 - cy * S, 0); r <= r1; ++r) {
+                    if (c->solid[r] & bits)
+                        return true;
+                }
+            }
+        }
+        return false;
+    }
+    // Solid ground within depth px below box
+    bool GroundUnder(Rectangle box, float depth = 1.0f) const {
+        return SolidIn({box.x, box.y + box.height, box.width, depth});
+    }
+    // A solid cell within dist px of box's side facing dir (sign of x)
+    bool WallAhead(Rectangle box, float dir, float dist) const {
+        float x = dir > 0 ? box.x + box.width : box.x - dist;
+        return SolidIn({x, box.y, dist, box.height});
+    }
+    // No ground under the dist px just past box's side facing dir, so one
+    // more step that way walks off
+    bool LedgeAhead(Rectangle box, float dir, float dist,
+                    float depth = 1.0f) const {
+        float x = dir > 0 ? box.x + box.width : box.x - dist;
+        return !SolidIn({x, box.y + box.height, dist, depth});
+    }
+
+    // Same test as CheckCollisionRecs, inlined for the query loops
+    static bool Overlaps(const Rectangle &a, const Rectangle &b) {
+        return a.x < b.x + b.width && a.x + a.width > b.x &&
+               a.y < b.y + b.height && a.y + a.height > b.y;
+    }
+
+    // Calls f(x, y, type, variant) for every occupied cell, in no set order
+    template <typename F> void ForEach(F f) const {
+        for (auto const &[key, c] : chunks) {
+            int cx = (int)(int32_t)(uint32_t)(key >> 32);
+            int cy = (int)(int32_t)(uint32_t)key;
+            for (int n = 0; n < TileChunk::SIZE * TileChunk::SIZE; ++n) {
+                if (c.type[n] != 0)
+                    f(cx * TileChunk::SIZE + n % TileChunk::SIZE,
+                      cy * TileChunk::SIZE + n / TileChunk::SIZE, c.type[n],
+                      c.variant[n]);
+            }
+        }
+    }
+
+    // Calls f(x, y, type, variant) for every occupied cell of chunk
+    // (cx, cy), in cell order
+    template <typename F> void ForEachInChunk(int cx, int cy, F f) const {
+        const TileChunk *c = ChunkAt(cx, cy);
+        if (!c)
+            return;
+        for (int n = 0; n < TileChunk::SIZE * TileChunk::SIZE; ++n) {
+            if (c->type[n] != 0)
+                f(cx * TileChunk::SIZE + n % TileChunk::SIZE,
+                  cy * TileChunk::SIZE + n / TileChunk::SIZE, c->type[n],
+                  c->variant[n]);
+        }
+    }
+
+  private:
+    size_t tileCount = 0;
+    std::vector<uint64_t> dirtyChunks;
+
+    // Chunk pointers over the bounding box of allocated chunks, so probes
+    // index instead of hashing. Map nodes never move, so the pointers only
+    // go stale when a chunk is added or dropped; that just marks it, and
+    // BakeColliders rebuilds it once, probes hashing until then. Left off
+    // (dense = false) when the chunks are spread too thin for the box to
+    // stay small.
+    std::vector<const TileChunk *> directory;
+    int dirX = 0, dirY = 0, dirW = 0, dirH = 0;
+    bool dense = true;
+    bool directoryStale = false;
+
+    void MarkDirty(uint64_t key, TileChunk &c);
+    static void BakeChunk(TileChunk &c, int cx, int cy);
+    void RebuildDirectory();
+
+    static uint64_t ChunkKey(int cx, int cy) {
+        return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+    }
+    // Arithmetic shift floors negatives, so -1 lands in chunk -1 slot 31
+    static int LocalIndex(int x, int y) {
+        return (y & (TileChunk::SIZE - 1)) * TileChunk::SIZE +
+               (x & (TileChunk::SIZE - 1));
+    }
+    const TileChunk *ChunkAt(int cx, int cy) const {
+        if (dense && !directoryStale) {
+            // One unsigned compare per axis also rejects cells left of / above
+            uint64_t x = (uint64_t)((int64_t)cx - dirX);
+            uint64_t y = (uint64_t)((int64_t)cy - dirY);
+            if (x >= (uint64_t)dirW || y >= (uint64_t)dirH)
+                return nullptr;
+            return directory[y * dirW + x];
+        }
+        auto it = chunks.find(ChunkKey(cx, cy));
+        return it == chunks.end() ? nullptr : &it->second;
+    }
+    const TileChunk *FindChunk(int x, int y) const {
+        return ChunkAt(x >> 5, y >> 5);
+    }
+};
+
+static_assert(TileChunk::SIZE == 32,
+              "FindChunk shifts by log2(SIZE), solid rows are 32 bits");
+
+extern TileMap tmap;
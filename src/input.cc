@@ -0,0 +1,32 @@
+#include "include/input.h"
+#include <bitset>
+#include <raylib.h>
+
+namespace {
+constexpr int MaxKeys = 512; // Raylib's MAX_KEYBOARD_KEYS
+
+std::bitset<MaxKeys> pressed;
+std::bitset<MaxKeys> released;
+} // namespace
+
+void LatchInput() {
+    for (int key = 0; key < MaxKeys; ++key) {
+        if (IsKeyPressed(key))
+            pressed.set(key);
+        if (IsKeyReleased(key))
+            released.set(key);
+    }
+}
+
+void ConsumeInput() {
+    pressed.reset();
+    released.reset();
+}
+
+bool TickKeyPressed(int key) {
+    return key >= 0 && key < MaxKeys && pressed.test(key);
+}
+
+bool TickKeyReleased(int key) {
+    return key >= 0 && key < MaxKeys && released.test(key);
+}
@@ -1,121 +1,317 @@
 #include "include/level.h"
+#include "include/behaves.h"
 #include "include/data.h"
 #include "include/entities.h"
+#include "include/levelfile.h"
+#include "include/tiles.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
 
-bool LevelManager::Save(const std::string &filename) {
-    nlohmann::json save;
-    nlohmann::json entitiesArray = nlohmann::json::array();
-    size_t count = em.physics.pos.size();
+// --- Saving ---
 
-    for (size_t i = 0; i < count; ++i) {
-        nlohmann::json entity;
+void LevelSnapshot::TakeAll() {
+    size_t count = em.GetActiveCount();
+    rows.typeID.reserve(count);
+    rows.varID.reserve(count);
+    rows.pos.reserve(count);
+    rows.siz.reserve(count);
+    rows.gravity.reserve(count);
+    rows.col.reserve(count);
+    rows.health.reserve(count);
+    rows.maxHealth.reserve(count);
+    rows.varStart.reserve(count + 1);
+    behaveMask.reserve(count);
+    ForEachSet(em.physics.active, [&](size_t i) { AddRow(i); });
 
-        entity["pos"] = {em.physics.pos[i].x, em.physics.pos[i].y};
-        entity["size"] = {em.physics.siz[i].x, em.physics.siz[i].y};
+    rows.tileX.reserve(tmap.Count());
+    rows.tileY.reserve(tmap.Count());
+    rows.tileType.reserve(tmap.Count());
+    rows.tileVariant.reserve(tmap.Count());
+    tmap.ForEach([&](int x, int y, uint16_t type, uint8_t variant) {
+        AddTile(x, y, type, variant);
+    });
+}
 
-        entity["gravity"] = em.physics.gravity[i];
+void LevelSnapshot::Take(std::span<const size_t> indices) {
+    for (size_t i : indices)
+        AddRow(i);
+}
 
-        entity["typeID"] = em.rendering.typeID[i];
-        entity["varID"] = em.rendering.varID[i];
+void LevelSnapshot::TakeTiles(int cx, int cy) {
+    tmap.ForEachInChunk(cx, cy,
+                        [&](int x, int y, uint16_t type, uint8_t variant) {
+                            AddTile(x, y, type, variant);
+                        });
+}
 
-        entity["color"] = {em.rendering.col[i].r, em.rendering.col[i].g,
-                           em.rendering.col[i].b, em.rendering.col[i].a};
+void LevelSnapshot::AddRow(size_t i) {
+    if (slotNames.empty())
+        slotNames = VarSlots.names;
 
-        entity["health"] = em.stats.health[i];
-        entity["maxHealth"] = em.stats.maxHealth[i];
+    rows.typeID.push_back(em.rendering.typeID[i]);
+    rows.varID.push_back(em.rendering.varID[i]);
+    rows.pos.push_back(em.physics.pos[i]);
+    rows.siz.push_back(em.physics.siz[i]);
+    rows.gravity.push_back(em.physics.gravity[i]);
+    rows.col.push_back(em.rendering.col[i]);
+    rows.health.push_back(em.stats.health[i]);
+    rows.maxHealth.push_back(em.stats.maxHealth[i]);
 
-        if (!em.vars[i].values.empty()) {
-            entity["vars"] = em.vars[i].values;
+    // Walked by presence word, most entities only set a few slots
+    const EntityVars &vars = em.vars[i];
+    for (size_t w = 0; w < vars.present.size(); ++w) {
+        for (uint64_t bits = vars.present[w]; bits; bits &= bits - 1) {
+            size_t slot = w * 64 + std::countr_zero(bits);
+            varSlot.push_back(slot);
+            rows.varValue.push_back(vars.values[slot]);
         }
-        if (!em.behs[i].values.empty()) {
-            entity["behs"] = em.behs[i].values;
+    }
+    rows.varStart.push_back(rows.varValue.size());
+    behaveMask.push_back(em.behs[i].mask);
+}
+
+void LevelSnapshot::AddTile(int x, int y, uint16_t type, uint8_t variant) {
+    rows.tileX.push_back(x);
+    rows.tileY.push_back(y);
+    rows.tileType.push_back(type);
+    rows.tileVariant.push_back(variant);
+    LookUpTile(tiles, type);
+}
+
+void LevelSnapshot::AppendTo(LevelColumns &out) const {
+    auto append = [](auto &to, const auto &from) {
+        to.insert(to.end(), from.begin(), from.end());
+    };
+    append(out.typeID, rows.typeID);
+    append(out.varID, rows.varID);
+    append(out.pos, rows.pos);
+    append(out.siz, rows.siz);
+    append(out.gravity, rows.gravity);
+    append(out.col, rows.col);
+    append(out.health, rows.health);
+    append(out.maxHealth, rows.maxHealth);
+    append(out.varValue, rows.varValue);
+
+    // Row by row, so strings are numbered in the order they turn up
+    std::vector<uint32_t> slotString(slotNames.size(), UINT32_MAX);
+    for (size_t k = 0; k < behaveMask.size(); ++k) {
+        for (uint32_t v = rows.varStart[k]; v < rows.varStart[k + 1]; ++v) {
+            uint16_t slot = varSlot[v];
+            if (slotString[slot] == UINT32_MAX)
+                slotString[slot] = out.Intern(slotNames[slot]);
+            out.varName.push_back(slotString[slot]);
         }
+        out.varStart.push_back(out.varName.size());
 
-        entitiesArray.push_back(entity);
+        uint64_t behaves = 0;
+        for (uint32_t mask = behaveMask[k]; mask; mask &= mask - 1) {
+            int b = std::countr_zero(mask);
+            behaves |= uint64_t{1} << out.BehaveBit(Behaves[b].name);
+        }
+        out.behaves.push_back(behaves);
     }
 
-    save["entities"] = entitiesArray;
+    append(out.tileX, rows.tileX);
+    append(out.tileY, rows.tileY);
+    append(out.tileType, rows.tileType);
+    append(out.tileVariant, rows.tileVariant);
+}
 
-    std::ofstream outFile(filename);
-    if (!outFile.is_open())
+// Names, sorts and writes a snapshot; reads nothing but the snapshot, so
+// it may run on any thread
+static bool WriteSnapshot(const LevelSnapshot &snap,
+                          const std::string &filename) {
+    LevelColumns level;
+    snap.AppendTo(level);
+    level.Sort(); // Sorted so saves diff cleanly
+    if (!WriteLevel(filename, level.View(), snap.Tiles()))
         return false;
 
-    outFile << save.dump(4); // Use 4-space indentation for readability
     TraceLog(LOG_INFO,
-             "FILEIO: Level saved successfully to %s. Saved %zu entities.",
-             filename.c_str(), count);
+             "FILEIO: Level saved successfully to %s. Saved %zu entities, "
+             "%zu tiles.",
+             filename.c_str(), level.typeID.size(), level.tileX.size());
     return true;
 }
 
-bool LevelManager::Load(const std::string &filename) {
-    std::ifstream inFile(filename);
-    if (!inFile.is_open())
-        return false;
+bool LevelManager::Save(const std::string &filename) {
+    LevelSnapshot snap;
+    snap.TakeAll();
+    return WriteSnapshot(snap, filename);
+}
 
-    nlohmann::json save;
-    try {
-        inFile >> save;
-    } catch (const nlohmann::json::parse_error &e) {
-        TraceLog(LOG_ERROR, "JSON PARSE ERROR in %s: %s", filename.c_str(),
-                 e.what());
+bool LevelManager::SaveAsync(const std::string &filename) {
+    CollectSave();
+    if (saving.valid())
         return false;
+
+    LevelSnapshot snap;
+    snap.TakeAll();
+    saving = std::async(std::launch::async,
+                        [snap = std::move(snap), filename] {
+                            return WriteSnapshot(snap, filename);
+                        });
+    return true;
+}
+
+LevelManager::SaveState LevelManager::PollSave() {
+    CollectSave();
+    if (finished != IDLE) {
+        SaveState done = finished;
+        finished = IDLE;
+        return done;
+    }
+    return saving.valid() ? RUNNING : IDLE;
+}
+
+void LevelManager::CollectSave() {
+    if (saving.valid() && saving.wait_for(std::chrono::seconds(0)) ==
+                              std::future_status::ready)
+        finished = saving.get() ? SAVED : FAILED;
+}
+
+// --- Loading ---
+
+// Each run of one type is spawned in one batch; its rows come back
+// contiguous, so the saved columns are copied over the type defaults in
+// bulk
+void LevelManager::Spawn(const LevelView &level) {
+    // Names are resolved once per call, not once per row
+    int behaveBit[64];
+    for (size_t n = 0; n < level.behaveNames.size(); ++n) {
+        std::string_view name = level.strings[level.behaveNames[n]];
+        behaveBit[n] = FindBehave(std::string(name));
+    }
+    std::vector<uint16_t> varSlot(level.strings.size(), UINT16_MAX);
+    for (uint32_t s : level.varName) {
+        if (varSlot[s] == UINT16_MAX)
+            varSlot[s] = VarSlots.Intern(std::string(level.strings[s]));
     }
 
-    Clear(); // Wipe current state
-
-    // Iterate safely through the "entities" array
-    for (auto &entityJson : save["entities"]) {
-        // 1. Extract IDs and basic numbers
-        int tID = entityJson.value("typeID", 0);
-        int vID = entityJson.value("varID", 0);
-        float grav = entityJson.value("gravity", 20.0f);
-        float hp = entityJson.value("health", 100.0f);
-        float maxHp =
-            entityJson.value("maxHealth", hp); // Default max to current hp
-
-        // 2. Extract Raylib Types (safely accessing array indices)
-        Vector2 pos = {0, 0};
-        auto p = entityJson.value("pos", std::vector<float>{0.0f, 0.0f});
-        if (p.size() >= 2) {
-            pos.x = p[0];
-            pos.y = p[1];
+    // The sparse fields, restored row by row
+    auto restore = [&](size_t k, size_t index) {
+        const Vector2 &pos = level.pos[k], &siz = level.siz[k];
+        em.physics.rect[index] = {pos.x, pos.y, siz.x, siz.y};
+        for (uint32_t v = level.varStart[k]; v < level.varStart[k + 1]; ++v)
+            em.vars[index].set(varSlot[level.varName[v]], level.varValue[v]);
+        for (uint64_t bits = level.behaves[k]; bits; bits &= bits - 1) {
+            int b = behaveBit[std::countr_zero(bits)];
+            if (b >= 0)
+                em.behs[index].set(b, true);
         }
+    };
 
-        Vector2 siz = {32, 32};
-        auto s = entityJson.value("size", std::vector<float>{32.0f, 32.0f});
-        if (s.size() >= 2) {
-            siz.x = s[0];
-            siz.y = s[1];
+    std::vector<size_t> indices;
+    for (size_t run = 0; run < level.entityCount;) {
+        size_t runEnd = run;
+        while (runEnd < level.entityCount &&
+               level.typeID[runEnd] == level.typeID[run])
+            ++runEnd;
+        size_t len = runEnd - run;
+
+        // A type that became a tile type since the level was saved is
+        // painted into the tilemap, once, from the saved row, the same way
+        // the JSON reader turns tile rows into tiles
+        if (em.IsTileType(level.typeID[run])) {
+            for (size_t k = run; k < runEnd; ++k) {
+                const Vector2 &pos = level.pos[k], &siz = level.siz[k];
+                tmap.Set(TileMap::CellOf(pos.x + siz.x * 0.5f),
+                         TileMap::CellOf(pos.y + siz.y * 0.5f),
+                         level.typeID[k], level.varID[k]);
+            }
+            run = runEnd;
+            continue;
+        }
+
+        // Types missing from the config still load one by one so they
+        // survive a round trip
+        if (!em.SpawnBatch(level.typeID[run], level.pos.subspan(run, len),
+                           &indices)) {
+            for (size_t k = run; k < runEnd; ++k) {
+                EntityHandle h =
+                    em.AddEntity(level.typeID[k], level.varID[k], level.pos[k],
+                                 level.siz[k], level.gravity[k], level.col[k]);
+                size_t index = em.Resolve(h);
+                em.stats.health[index] = level.health[k];
+                em.stats.maxHealth[index] = level.maxHealth[k];
+                restore(k, index);
+            }
+            run = runEnd;
+            continue;
         }
 
-        Color col = WHITE;
-        auto c =
-            entityJson.value("color", std::vector<int>{255, 255, 255, 255});
-        if (c.size() >= 4) {
-            col.r = c[0];
-            col.g = c[1];
-            col.b = c[2];
-            col.a = c[3];
+        // Refilled tombstones come first, so on a live level the run can
+        // be scattered even when its two ends look right
+        size_t first = indices[0];
+        bool contiguous = true;
+        for (size_t k = 1; k < len && contiguous; ++k)
+            contiguous = indices[k] == first + k;
+        for (size_t k = 0; k < len && !contiguous; ++k) {
+            size_t index = indices[k], from = run + k;
+            em.rendering.varID[index] = level.varID[from];
+            em.rendering.col[index] = level.col[from];
+            em.physics.siz[index] = level.siz[from];
+            em.physics.gravity[index] = level.gravity[from];
+            em.stats.health[index] = level.health[from];
+            em.stats.maxHealth[index] = level.maxHealth[from];
+        }
+        if (contiguous) {
+            auto copy = [&](auto from, auto &to) {
+                std::copy_n(from.begin() + run, len, to.begin() + first);
+            };
+            copy(level.varID, em.rendering.varID);
+            copy(level.col, em.rendering.col);
+            copy(level.siz, em.physics.siz);
+            copy(level.gravity, em.physics.gravity);
+            copy(level.health, em.stats.health);
+            copy(level.maxHealth, em.stats.maxHealth);
         }
+        for (size_t k = 0; k < len; ++k)
+            restore(run + k, indices[k]);
 
-        // 3. Re-create the entity base
-        size_t index = em.AddEntity(tID, vID, pos, siz, grav, col);
+        run = runEnd;
+    }
 
-        // 4. Restore Stats & Maps (uses .get<> to map JSON object back to
-        // std::unordered_map)
-        em.stats.health[index] = hp;
-        em.stats.maxHealth[index] = maxHp;
+    for (size_t k = 0; k < level.tileCount; ++k)
+        tmap.Set(level.tileX[k], level.tileY[k], level.tileType[k],
+                 level.tileVariant[k]);
+}
 
-        if (entityJson.contains("vars"))
-            em.vars[index].values =
-                entityJson["vars"]
-                    .get<std::unordered_map<std::string, float>>();
+// Rows a JSON level is spawned in, so only one piece is ever held as
+// columns however big the file is
+static constexpr size_t LoadPiece = 16384;
 
-        if (entityJson.contains("behs"))
-            em.behs[index].values =
-                entityJson["behs"]
-                    .get<std::unordered_map<std::string, float>>();
+bool LevelManager::Load(const std::string &filename) {
+    if (IsBinaryLevel(filename)) {
+        // Mapped and spawned in place
+        MappedLevel mapped;
+        if (!mapped.Open(filename))
+            return false;
+        Clear(); // Wipe current state
+        em.Reserve(mapped.View().entityCount);
+        Spawn(mapped.View());
+    } else {
+        // Streamed, each piece spawned as soon as it is parsed. The current
+        // level is only wiped once the first piece is in, so a file that
+        // fails before then leaves it alone.
+        bool cleared = false;
+        auto spawn = [&](LevelColumns &piece) {
+            if (!cleared)
+                Clear();
+            cleared = true;
+            piece.Sort();
+            Spawn(piece.View());
+        };
+        LevelColumns piece;
+        if (!ReadLevelJson(filename, piece, LoadPiece, spawn)) {
+            if (cleared)
+                Clear(); // Rather nothing than half a level
+            return false;
+        }
+        spawn(piece);
     }
+    tmap.BakeColliders();
 
     TraceLog(LOG_INFO, "FILEIO: Level [%s] loaded successfully.",
              filename.c_str());
@@ -123,34 +319,6 @@ bool LevelManager::Load(const std::string &filename) {
 }
 
 void LevelManager::Clear() {
-    em.physics.pos.clear();
-    em.physics.vel.clear();
-    em.physics.scale.clear();
-    em.physics.siz.clear();
-    em.physics.rect.clear();
-    em.physics.rectX.clear();
-    em.physics.rectY.clear();
-    em.physics.gravity.clear();
-    em.physics.active.clear();
-    em.physics.initialized.clear();
-    em.physics.collide.clear();
-    em.physics.grounded.clear();
-    em.physics.walled.clear();
-
-    em.rendering.varID.clear();
-    em.rendering.typeID.clear();
-    em.rendering.col.clear();
-    em.rendering.rotation.clear();
-    em.rendering.texDraw.clear();
-    em.rendering.frameNum.clear();
-    em.rendering.rowIndex.clear();
-    em.rendering.frameSpd.clear();
-    em.rendering.frameMin.clear();
-    em.rendering.frameMax.clear();
-
-    em.stats.health.clear();
-    em.stats.maxHealth.clear();
-
-    em.vars.clear();
-    em.behs.clear();
+    em.Clear();
+    tmap.Clear();
 }
@@ -0,0 +1,834 @@
+#include "include/levelfile.h"
+#include "include/behaves.h"
+#include "include/data.h"
+#include "include/entities.h"
+#include "include/tiles.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+
+// --- Columns ---
+
+uint32_t LevelColumns::Intern(std::string_view name) {
+    auto [it, added] = lookup.try_emplace(std::string(name), strings.size());
+    if (added)
+        strings.emplace_back(name);
+    return it->second;
+}
+
+int LevelColumns::BehaveBit(std::string_view name) {
+    uint32_t s = Intern(name);
+    for (size_t b = 0; b < behaveNames.size(); ++b) {
+        if (behaveNames[b] == s)
+            return (int)b;
+    }
+    if (behaveNames.size() == 64)
+        return -1;
+    behaveNames.push_back(s);
+    return (int)behaveNames.size() - 1;
+}
+
+// Reorders col by order, where order[k] is the old row that lands at k
+template <typename T>
+static void Gather(std::vector<T> &col, const std::vector<uint32_t> &order) {
+    std::vector<T> sorted(order.size());
+    for (size_t k = 0; k < order.size(); ++k)
+        sorted[k] = col[order[k]];
+    col = std::move(sorted);
+}
+
+void LevelColumns::Sort() {
+    std::vector<uint32_t> order(typeID.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (!std::is_sorted(typeID.begin(), typeID.end())) {
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a,
+                                                         uint32_t b) {
+            return typeID[a] < typeID[b];
+        });
+
+        // Vars are runs per row, so they move run by run
+        std::vector<uint32_t> start = {0}, name;
+        std::vector<float> value;
+        name.reserve(varName.size());
+        value.reserve(varValue.size());
+        for (uint32_t row : order) {
+            for (uint32_t v = varStart[row]; v < varStart[row + 1]; ++v) {
+                name.push_back(varName[v]);
+                value.push_back(varValue[v]);
+            }
+            start.push_back(name.size());
+        }
+        varStart = std::move(start);
+        varName = std::move(name);
+        varValue = std::move(value);
+
+        Gather(typeID, order);
+        Gather(varID, order);
+        Gather(pos, order);
+        Gather(siz, order);
+        Gather(gravity, order);
+        Gather(health, order);
+        Gather(maxHealth, order);
+        Gather(col, order);
+        Gather(behaves, order);
+    }
+
+    order.resize(tileX.size());
+    std::iota(order.begin(), order.end(), 0);
+    auto rowMajor = [&](uint32_t a, uint32_t b) {
+        return std::tie(tileY[a], tileX[a]) < std::tie(tileY[b], tileX[b]);
+    };
+    if (!std::is_sorted(order.begin(), order.end(), rowMajor)) {
+        std::stable_sort(order.begin(), order.end(), rowMajor);
+        Gather(tileX, order);
+        Gather(tileY, order);
+        Gather(tileType, order);
+        Gather(tileVariant, order);
+    }
+}
+
+void LevelColumns::ClearRows() {
+    typeID.clear();
+    varID.clear();
+    pos.clear();
+    siz.clear();
+    gravity.clear();
+    health.clear();
+    maxHealth.clear();
+    col.clear();
+    behaves.clear();
+    varStart.assign(1, 0);
+    varName.clear();
+    varValue.clear();
+
+    tileX.clear();
+    tileY.clear();
+    tileType.clear();
+    tileVariant.clear();
+}
+
+void LevelColumns::Append(const LevelView &level) {
+    // Each of level's names is looked up once, not once per use
+    std::vector<uint32_t> string(level.strings.size(), UINT32_MAX);
+    int bit[64];
+    for (size_t n = 0; n < level.behaveNames.size(); ++n)
+        bit[n] = BehaveBit(level.strings[level.behaveNames[n]]);
+
+    auto append = [](auto &to, auto from) {
+        to.insert(to.end(), from.begin(), from.end());
+    };
+    append(typeID, level.typeID);
+    append(varID, level.varID);
+    append(pos, level.pos);
+    append(siz, level.siz);
+    append(gravity, level.gravity);
+    append(health, level.health);
+    append(maxHealth, level.maxHealth);
+    append(col, level.col);
+    append(varValue, level.varValue);
+
+    for (size_t k = 0; k < level.entityCount; ++k) {
+        for (uint32_t v = level.varStart[k]; v < level.varStart[k + 1];
+             ++v) {
+            uint32_t s = level.varName[v];
+            if (string[s] == UINT32_MAX)
+                string[s] = Intern(level.strings[s]);
+            varName.push_back(string[s]);
+        }
+        varStart.push_back(varName.size());
+
+        uint64_t bits = 0;
+        for (uint64_t b = level.behaves[k]; b; b &= b - 1) {
+            int to = bit[std::countr_zero(b)];
+            if (to >= 0)
+                bits |= uint64_t{1} << to;
+        }
+        behaves.push_back(bits);
+    }
+
+    append(tileX, level.tileX);
+    append(tileY, level.tileY);
+    append(tileType, level.tileType);
+    append(tileVariant, level.tileVariant);
+}
+
+LevelView LevelColumns::View() const {
+    LevelView v;
+    v.entityCount = typeID.size();
+    v.typeID = typeID;
+    v.varID = varID;
+    v.pos = pos;
+    v.siz = siz;
+    v.gravity = gravity;
+    v.health = health;
+    v.maxHealth = maxHealth;
+    v.col = col;
+    v.behaves = behaves;
+    v.varStart = varStart;
+    v.varName = varName;
+    v.varValue = varValue;
+    v.behaveNames = behaveNames;
+
+    v.tileCount = tileX.size();
+    v.tileX = tileX;
+    v.tileY = tileY;
+    v.tileType = tileType;
+    v.tileVariant = tileVariant;
+
+    v.strings.assign(strings.begin(), strings.end());
+    return v;
+}
+
+// --- Binary ---
+
+static size_t AlignUp(size_t n) {
+    return (n + LevelAlign - 1) & ~(LevelAlign - 1);
+}
+
+bool IsBinaryLevel(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    uint32_t magic = 0;
+    in.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    return in && magic == LevelMagic;
+}
+
+bool IsJsonPath(const std::string &path) {
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+}
+
+bool WriteLevelBinary(const std::string &path, const LevelView &level) {
+    // Strings go in as one blob plus offsets
+    std::vector<uint32_t> stringStart = {0};
+    std::string chars;
+    for (std::string_view s : level.strings) {
+        chars += s;
+        stringStart.push_back(chars.size());
+    }
+
+    struct Block {
+        uint32_t id, elemSize;
+        const void *data;
+        uint64_t count;
+    };
+    auto block = [](uint32_t id, auto span) {
+        return Block{id, (uint32_t)sizeof(span[0]), span.data(), span.size()};
+    };
+    const Block blocks[] = {
+        block(SEC_TYPE_ID, level.typeID),
+        block(SEC_VAR_ID, level.varID),
+        block(SEC_POS, level.pos),
+        block(SEC_SIZE, level.siz),
+        block(SEC_GRAVITY, level.gravity),
+        block(SEC_COLOR, level.col),
+        block(SEC_HEALTH, level.health),
+        block(SEC_MAX_HEALTH, level.maxHealth),
+        block(SEC_BEHAVES, level.behaves),
+        block(SEC_VAR_START, level.varStart),
+        block(SEC_VAR_NAME, level.varName),
+        block(SEC_VAR_VALUE, level.varValue),
+        block(SEC_BEHAVE_NAMES, level.behaveNames),
+        block(SEC_TILE_X, level.tileX),
+        block(SEC_TILE_Y, level.tileY),
+        block(SEC_TILE_TYPE, level.tileType),
+        block(SEC_TILE_VARIANT, level.tileVariant),
+        block(SEC_STRING_START, std::span<const uint32_t>(stringStart)),
+        block(SEC_STRING_CHARS, std::span<const char>(chars)),
+    };
+    constexpr size_t count = std::size(blocks);
+
+    LevelHeader header = {LevelMagic,
+                          LevelVersion,
+                          (uint32_t)level.entityCount,
+                          (uint32_t)level.tileCount,
+                          (uint32_t)count,
+                          0};
+    LevelSection sections[count];
+    size_t offset = AlignUp(sizeof(header) + sizeof(sections));
+    for (size_t s = 0; s < count; ++s) {
+        sections[s] = {blocks[s].id, blocks[s].elemSize, offset,
+                       blocks[s].count};
+        offset = AlignUp(offset + blocks[s].elemSize * blocks[s].count);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    static const char zeros[LevelAlign] = {};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(sections), sizeof(sections));
+    size_t at = sizeof(header) + sizeof(sections);
+    for (size_t s = 0; s < count; ++s) {
+        out.write(zeros, sections[s].offset - at);
+        size_t bytes = blocks[s].elemSize * blocks[s].count;
+        out.write(static_cast<const char *>(blocks[s].data), bytes);
+        at = sections[s].offset + bytes;
+    }
+    out.write(zeros, AlignUp(at) - at);
+
+    if (!out) {
+        TraceLog(LOG_ERROR, "LEVEL: Failed writing [%s]", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+MappedLevel::~MappedLevel() {
+    if (base)
+        munmap(base, size);
+}
+
+bool MappedLevel::Open(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(LevelHeader)) {
+        close(fd);
+        TraceLog(LOG_ERROR, "LEVEL: [%s] is too short", path.c_str());
+        return false;
+    }
+
+    // The mapping outlives the descriptor
+    size = st.st_size;
+    base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        base = nullptr;
+        TraceLog(LOG_ERROR, "LEVEL: Failed to map [%s]", path.c_str());
+        return false;
+    }
+    madvise(base, size, MADV_SEQUENTIAL);
+
+    const char *data = static_cast<const char *>(base);
+    auto fail = [&](const char *why) {
+        TraceLog(LOG_ERROR, "LEVEL: [%s] %s", path.c_str(), why);
+        munmap(base, size);
+        base = nullptr;
+        view = {};
+        return false;
+    };
+
+    LevelHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != LevelMagic)
+        return fail("is not a binary level");
+    if (header.version != LevelVersion)
+        return fail("has an unsupported version");
+    if (header.sectionCount > (size - sizeof(header)) / sizeof(LevelSection))
+        return fail("has a truncated section table");
+
+    const LevelSection *sections =
+        reinterpret_cast<const LevelSection *>(data + sizeof(header));
+
+    // Finds section id and checks it holds count whole elements of T inside
+    // the file; count = SIZE_MAX takes whatever is there
+    bool ok = true;
+    auto column = [&]<typename T>(uint32_t id, std::span<const T> &out,
+                                  size_t count) {
+        for (uint32_t s = 0; s < header.sectionCount; ++s) {
+            const LevelSection &sec = sections[s];
+            if (sec.id != id)
+                continue;
+            if (sec.elemSize != sizeof(T) || sec.offset % alignof(T) != 0 ||
+                sec.offset > size ||
+                sec.count > (size - sec.offset) / sizeof(T) ||
+                (count != SIZE_MAX && sec.count != count))
+                break;
+            out = {reinterpret_cast<const T *>(data + sec.offset),
+                   (size_t)sec.count};
+            return;
+        }
+        ok = false;
+    };
+
+    size_t n = header.entityCount, t = header.tileCount;
+    view.entityCount = n;
+    view.tileCount = t;
+    column(SEC_TYPE_ID, view.typeID, n);
+    column(SEC_VAR_ID, view.varID, n);
+    column(SEC_POS, view.pos, n);
+    column(SEC_SIZE, view.siz, n);
+    column(SEC_GRAVITY, view.gravity, n);
+    column(SEC_COLOR, view.col, n);
+    column(SEC_HEALTH, view.health, n);
+    column(SEC_MAX_HEALTH, view.maxHealth, n);
+    column(SEC_BEHAVES, view.behaves, n);
+    column(SEC_VAR_START, view.varStart, n + 1);
+    column(SEC_VAR_NAME, view.varName, SIZE_MAX);
+    column(SEC_VAR_VALUE, view.varValue, view.varName.size());
+    column(SEC_BEHAVE_NAMES, view.behaveNames, SIZE_MAX);
+    column(SEC_TILE_X, view.tileX, t);
+    column(SEC_TILE_Y, view.tileY, t);
+    column(SEC_TILE_TYPE, view.tileType, t);
+    column(SEC_TILE_VARIANT, view.tileVariant, t);
+    std::span<const uint32_t> stringStart;
+    std::span<const char> chars;
+    column(SEC_STRING_START, stringStart, SIZE_MAX);
+    column(SEC_STRING_CHARS, chars, SIZE_MAX);
+    if (!ok)
+        return fail("is missing a section or has a malformed one");
+
+    // Offsets and indices are checked once here so loading can trust them
+    if (stringStart.empty() || stringStart[0] != 0 ||
+        !std::is_sorted(stringStart.begin(), stringStart.end()) ||
+        stringStart.back() > chars.size())
+        return fail("has a malformed string table");
+    size_t strings = stringStart.size() - 1;
+    view.strings.resize(strings);
+    for (size_t s = 0; s < strings; ++s)
+        view.strings[s] = {chars.data() + stringStart[s],
+                           stringStart[s + 1] - stringStart[s]};
+
+    if (view.varStart[0] != 0 ||
+        !std::is_sorted(view.varStart.begin(), view.varStart.end()) ||
+        view.varStart[n] != view.varName.size())
+        return fail("has malformed var offsets");
+    for (uint32_t s : view.varName) {
+        if (s >= strings)
+            return fail("has a var name out of range");
+    }
+
+    if (view.behaveNames.size() > 64)
+        return fail("has more than 64 behaviors");
+    for (uint32_t s : view.behaveNames) {
+        if (s >= strings)
+            return fail("has a behavior name out of range");
+    }
+    uint64_t used = 0;
+    for (uint64_t bits : view.behaves)
+        used |= bits;
+    if (view.behaveNames.size() < 64 &&
+        (used >> view.behaveNames.size()) != 0)
+        return fail("uses an unnamed behavior bit");
+
+    return true;
+}
+
+// --- JSON ---
+
+namespace {
+
+// Builds rows from SAX events as the file streams past. Only the shape the
+// writer produces is looked at, an "entities" array of flat objects;
+// anything else is skipped whole. Besides the columns, the one row being
+// parsed is all that is held, and its buffers are reused row to row.
+class LevelSax final : public nlohmann::json_sax<nlohmann::json> {
+  public:
+    LevelSax(const std::string &path, LevelColumns &out, size_t rows,
+             const std::function<void(LevelColumns &)> *flush)
+        : path(path), out(out), rows(rows), flush(flush) {}
+
+    bool null() override { return Other(); }
+    bool boolean(bool) override { return Other(); }
+    bool number_integer(number_integer_t v) override {
+        return Number((double)v);
+    }
+    bool number_unsigned(number_unsigned_t v) override {
+        return Number((double)v);
+    }
+    bool number_float(number_float_t v, const string_t &) override {
+        return Number(v);
+    }
+    bool string(string_t &) override { return Other(); }
+    bool binary(binary_t &) override { return Other(); }
+
+    bool key(string_t &k) override {
+        name = k; // Reuses name's buffer, so no allocation per key
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        Scope in = scopes.empty() ? SKIP : scopes.back();
+        Scope next = SKIP;
+        if (scopes.empty()) {
+            next = ROOT;
+        } else if (in == ENTITIES) {
+            next = ENTITY;
+            row = Row{};
+            varCount = behCount = 0;
+        } else if (in == ENTITY && name == "vars") {
+            next = VARS;
+        } else if (in == ENTITY && name == "behs") {
+            next = BEHS;
+        } else if (in == BEHS) {
+            AddBehave();
+        } else if (in == ARRAY) {
+            mixed = true;
+        }
+        scopes.push_back(next);
+        return true;
+    }
+
+    bool end_object() override {
+        if (scopes.back() == ENTITY)
+            EndRow();
+        scopes.pop_back();
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        Scope in = scopes.empty() ? SKIP : scopes.back();
+        Scope next = SKIP;
+        if (in == ROOT && name == "entities") {
+            next = ENTITIES;
+        } else if (in == ENTITY &&
+                   (name == "pos" || name == "size" || name == "color")) {
+            next = ARRAY;
+            field = name[0];
+            count = 0;
+            mixed = false;
+        } else if (in == BEHS) {
+            AddBehave();
+        } else if (in == ARRAY) {
+            mixed = true;
+        }
+        scopes.push_back(next);
+        return true;
+    }
+
+    bool end_array() override {
+        // Short arrays keep the default; so do ones holding anything but
+        // numbers, which the DOM reader threw on
+        if (scopes.back() == ARRAY && !mixed) {
+            if (field == 'p' && count >= 2)
+                row.pos = {(float)array[0], (float)array[1]};
+            else if (field == 's' && count >= 2)
+                row.siz = {(float)array[0], (float)array[1]};
+            else if (field == 'c' && count >= 4)
+                row.col = {(unsigned char)(int)array[0],
+                           (unsigned char)(int)array[1],
+                           (unsigned char)(int)array[2],
+                           (unsigned char)(int)array[3]};
+        }
+        scopes.pop_back();
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string &,
+                     const nlohmann::detail::exception &e) override {
+        TraceLog(LOG_ERROR, "JSON PARSE ERROR in %s: %s", path.c_str(),
+                 e.what());
+        return false;
+    }
+
+  private:
+    enum Scope : uint8_t { SKIP, ROOT, ENTITIES, ENTITY, ARRAY, VARS, BEHS };
+
+    struct Row {
+        int typeID = 0, varID = 0;
+        Vector2 pos = {0, 0}, siz = {32, 32};
+        Color col = WHITE;
+        float gravity = 20.0f, health = 100.0f, maxHealth = 0.0f;
+        bool hasMaxHealth = false;
+    };
+
+    const std::string &path;
+    LevelColumns &out;
+    size_t rows;
+    const std::function<void(LevelColumns &)> *flush;
+
+    std::vector<Scope> scopes; // One per open object or array
+    std::string name;          // Last key read
+
+    Row row;
+    char field = 0; // First letter of the array being read
+    double array[4];
+    int count = 0;
+    bool mixed = false; // Something other than a number in the array
+    // Names are only interned once the row is known not to be a tile
+    std::vector<std::string> varNames, behNames;
+    std::vector<float> varValues;
+    size_t varCount = 0, behCount = 0;
+
+    bool Number(double v) {
+        if (scopes.empty())
+            return true;
+        switch (scopes.back()) {
+        case ENTITY:
+            if (name == "typeID")
+                row.typeID = (int)v;
+            else if (name == "varID")
+                row.varID = (int)v;
+            else if (name == "gravity")
+                row.gravity = (float)v;
+            else if (name == "health")
+                row.health = (float)v;
+            else if (name == "maxHealth") {
+                row.maxHealth = (float)v;
+                row.hasMaxHealth = true;
+            }
+            break;
+        case ARRAY:
+            if (count < 4)
+                array[count] = v;
+            ++count;
+            break;
+        case VARS:
+            if (varCount == varNames.size()) {
+                varNames.emplace_back();
+                varValues.emplace_back();
+            }
+            varNames[varCount] = name;
+            varValues[varCount++] = (float)v;
+            break;
+        case BEHS:
+            AddBehave();
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    // Anything but a number or a container
+    bool Other() {
+        if (!scopes.empty() && scopes.back() == BEHS)
+            AddBehave();
+        else if (!scopes.empty() && scopes.back() == ARRAY)
+            mixed = true;
+        return true;
+    }
+
+    // Behaviors count by key, whatever the value
+    void AddBehave() {
+        if (behCount == behNames.size())
+            behNames.emplace_back();
+        behNames[behCount++] = name;
+    }
+
+    void EndRow() {
+        // Tiles go to the tile table, keyed by their center cell
+        if (em.IsTileType(row.typeID)) {
+            out.tileX.push_back(
+                TileMap::CellOf(row.pos.x + row.siz.x * 0.5f));
+            out.tileY.push_back(
+                TileMap::CellOf(row.pos.y + row.siz.y * 0.5f));
+            out.tileType.push_back(row.typeID);
+            out.tileVariant.push_back(row.varID);
+        } else {
+            out.typeID.push_back(row.typeID);
+            out.varID.push_back(row.varID);
+            out.pos.push_back(row.pos);
+            out.siz.push_back(row.siz);
+            out.gravity.push_back(row.gravity);
+            out.health.push_back(row.health);
+            out.maxHealth.push_back(row.hasMaxHealth ? row.maxHealth
+                                                     : row.health);
+            out.col.push_back(row.col);
+
+            for (size_t v = 0; v < varCount; ++v) {
+                out.varName.push_back(out.Intern(varNames[v]));
+                out.varValue.push_back(varValues[v]);
+            }
+            out.varStart.push_back(out.varName.size());
+
+            uint64_t behaves = 0;
+            for (size_t n = 0; n < behCount; ++n) {
+                int b = out.BehaveBit(behNames[n]);
+                if (b >= 0)
+                    behaves |= uint64_t{1} << b;
+            }
+            out.behaves.push_back(behaves);
+        }
+
+        if (flush && out.typeID.size() + out.tileX.size() >= rows) {
+            (*flush)(out);
+            out.ClearRows();
+        }
+    }
+};
+
+bool StreamLevelJson(const std::string &path, LevelColumns &out, size_t rows,
+                     const std::function<void(LevelColumns &)> *flush) {
+    // The default stream buffer refills every few KB
+    std::vector<char> buffer(1 << 16);
+    std::ifstream inFile;
+    inFile.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    inFile.open(path, std::ios::binary);
+    if (!inFile.is_open())
+        return false;
+
+    out = LevelColumns{};
+    LevelSax sax(path, out, rows, flush);
+    return nlohmann::json::sax_parse(inFile, &sax);
+}
+
+} // namespace
+
+bool ReadLevelJson(const std::string &path, LevelColumns &out) {
+    if (!StreamLevelJson(path, out, 0, nullptr))
+        return false;
+    out.Sort();
+    return true;
+}
+
+bool ReadLevelJson(const std::string &path, LevelColumns &out, size_t rows,
+                   const std::function<void(LevelColumns &)> &flush) {
+    return StreamLevelJson(path, out, std::max<size_t>(rows, 1), &flush);
+}
+
+void LookUpTile(TileLooks &looks, uint16_t type) {
+    auto [it, added] = looks.try_emplace(type);
+    if (!added)
+        return;
+
+    int t = GetDenseType(type);
+    if (t < 0 || t >= (int)em.typeConfigs.size())
+        return;
+    if (const EntityConfig *cfg = em.typeConfigs[t]) {
+        it->second.color = cfg->color;
+        it->second.health = cfg->health;
+    }
+    for (int b = 0; b < BEH_COUNT; ++b) {
+        if (em.typeBehaves[t] & (1u << b))
+            it->second.behaves.push_back(Behaves[b].name);
+    }
+}
+
+bool WriteLevelJson(const std::string &path, const LevelView &level,
+                    const TileLooks &tiles) {
+    nlohmann::json save;
+    nlohmann::json entitiesArray = nlohmann::json::array();
+
+    for (size_t k = 0; k < level.entityCount; ++k) {
+        nlohmann::json entity;
+
+        entity["pos"] = {level.pos[k].x, level.pos[k].y};
+        entity["size"] = {level.siz[k].x, level.siz[k].y};
+
+        entity["gravity"] = level.gravity[k];
+
+        entity["typeID"] = level.typeID[k];
+        entity["varID"] = level.varID[k];
+
+        const Color &col = level.col[k];
+        entity["color"] = {col.r, col.g, col.b, col.a};
+
+        entity["health"] = level.health[k];
+        entity["maxHealth"] = level.maxHealth[k];
+
+        if (level.varStart[k] != level.varStart[k + 1]) {
+            nlohmann::json vars = nlohmann::json::object();
+            for (uint32_t v = level.varStart[k]; v < level.varStart[k + 1];
+                 ++v)
+                vars[std::string(level.strings[level.varName[v]])] =
+                    level.varValue[v];
+            entity["vars"] = vars;
+        }
+        if (level.behaves[k] != 0) {
+            nlohmann::json behs = nlohmann::json::object();
+            for (uint64_t bits = level.behaves[k]; bits; bits &= bits - 1) {
+                uint32_t s = level.behaveNames[std::countr_zero(bits)];
+                behs[std::string(level.strings[s])] = 1.0f;
+            }
+            entity["behs"] = behs;
+        }
+
+        entitiesArray.push_back(entity);
+    }
+
+    // Tiles are written as ordinary entity entries so the format stays
+    // readable by older builds; what the tile table doesn't store comes
+    // from the type's look
+    const TileLook plain;
+    for (size_t k = 0; k < level.tileCount; ++k) {
+        uint16_t type = level.tileType[k];
+        auto it = tiles.find(type);
+        const TileLook &look = it != tiles.end() ? it->second : plain;
+        Rectangle r = TileMap::CellRect(level.tileX[k], level.tileY[k]);
+        const Color &col = look.color;
+
+        nlohmann::json entity;
+        entity["pos"] = {r.x, r.y};
+        entity["size"] = {r.width, r.height};
+        entity["gravity"] = 0.0f;
+        entity["typeID"] = type;
+        entity["varID"] = level.tileVariant[k];
+        entity["color"] = {col.r, col.g, col.b, col.a};
+        entity["health"] = look.health;
+        entity["maxHealth"] = look.health;
+
+        nlohmann::json behs = nlohmann::json::object();
+        for (const std::string &name : look.behaves)
+            behs[name] = 1.0f;
+        entity["behs"] = behs;
+
+        entitiesArray.push_back(entity);
+    }
+
+    save["entities"] = entitiesArray;
+
+    std::ofstream outFile(path);
+    if (!outFile.is_open())
+        return false;
+
+    outFile << save.dump(4); // Use 4-space indentation for readability
+    return (bool)outFile;
+}
+
+// --- Either format ---
+
+bool ReadLevel(const std::string &path, LevelColumns &out) {
+    if (!IsBinaryLevel(path))
+        return ReadLevelJson(path, out);
+
+    MappedLevel mapped;
+    if (!mapped.Open(path))
+        return false;
+    out = LevelColumns{};
+    out.Append(mapped.View());
+    return true;
+}
+
+bool WriteLevel(const std::string &path, const LevelView &level,
+                const TileLooks &tiles) {
+    std::string temp = path + ".tmp";
+    bool written = IsJsonPath(path) ? WriteLevelJson(temp, level, tiles)
+                                    : WriteLevelBinary(temp, level);
+    if (!written || std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ConvertLevel(const std::string &from, const std::string &to) {
+    MappedLevel mapped;
+    LevelColumns columns;
+    LevelView view;
+    if (IsBinaryLevel(from)) {
+        if (!mapped.Open(from))
+            return false;
+        view = mapped.View();
+    } else {
+        if (!ReadLevelJson(from, columns))
+            return false;
+        view = columns.View();
+    }
+
+    TileLooks tiles;
+    for (uint16_t type : view.tileType)
+        LookUpTile(tiles, type);
+    bool ok = IsJsonPath(to) ? WriteLevelJson(to, view, tiles)
+                             : WriteLevelBinary(to, view);
+    if (ok) {
+        TraceLog(LOG_INFO, "LEVEL: Converted [%s] -> [%s], %zu entities, "
+                           "%zu tiles",
+                 from.c_str(), to.c_str(), view.entityCount, view.tileCount);
+    } else {
+        TraceLog(LOG_ERROR, "LEVEL: Failed converting [%s] -> [%s]",
+                 from.c_str(), to.c_str());
+    }
+    return ok;
+}
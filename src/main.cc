@@ -3,7 +3,11 @@
 #include "include/entities.h"
 #include "include/game.h"
 #include "include/level.h"
+#include "include/levelfile.h"
+#include "include/streaming.h"
+#include "include/tiles.h"
 #include "raylib.h"
+#include <string>
 
 Camera2D camera;
 Game game;
@@ -11,8 +15,47 @@ AssetManager am;
 EntityManager em;
 LevelManager lm;
 CollisionSystem cS;
+TileMap tmap;
+LevelStreamer streamer; // Last, so it closes while the rest still exist
+
+int main(int argc, char **argv) {
+    // game --convert <in> <out>: rewrites a level as JSON or binary, picked
+    // by the output's extension, without opening a window
+    if (argc > 1 && std::string(argv[1]) == "--convert") {
+        if (argc != 4) {
+            TraceLog(LOG_ERROR, "Usage: %s --convert <in> <out>", argv[0]);
+            return 1;
+        }
+        em.LoadConfigs("assets/entities.json"); // Tells tiles from entities
+        return ConvertLevel(argv[2], argv[3]) ? 0 : 1;
+    }
+    // game --split <level> <dir>: writes a level out as streaming chunks
+    if (argc > 1 && std::string(argv[1]) == "--split") {
+        if (argc != 4) {
+            TraceLog(LOG_ERROR, "Usage: %s --split <level> <dir>", argv[0]);
+            return 1;
+        }
+        em.LoadConfigs("assets/entities.json");
+        return LevelStreamer::Split(argv[2], argv[3]) ? 0 : 1;
+    }
+    // game --stress-sweep: fires walkers at tile walls at rising speeds and
+    // tick lengths, and fails if any of them ends up on the far side
+    if (argc > 1 && std::string(argv[1]) == "--stress-sweep") {
+        em.LoadConfigs("assets/entities.json");
+        const struct {
+            float hz, speed;
+        } runs[] = {{60, 3000}, {60, 20000}, {20, 20000}, {60, 200000}};
+        bool ok = true;
+        for (const auto &r : runs) {
+            const size_t out = cS.StressSweep(10000, r.speed, r.hz);
+            TraceLog(out ? LOG_ERROR : LOG_INFO,
+                     "stress-sweep %.0f Hz, %.0f px/s: %zu escaped", r.hz,
+                     r.speed, out);
+            ok = ok && out == 0;
+        }
+        return ok ? 0 : 1;
+    }
 
-int main() {
     const int screenWidth = 640;
     const int screenHeight = 450;
     const int FrameCap = 60;
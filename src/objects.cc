@@ -3,11 +3,46 @@
 #include "include/entities.h"
 #include <cstddef>
 
-void ObjectSystem(EntityManager &em, size_t i) {
+void ObjectSystem(EntityManager &em, size_t i, float /*dt*/) {
     if (em.rendering.typeID[i] == EntityTys::TYHITBOX) {
     }
     if (em.rendering.typeID[i] == EntityTys::TYHURTBOX) {
     }
+    if (em.rendering.typeID[i] == EntityTys::TYBULLET) {
+        // Spent on the first tile it reaches; removed with the other dead
+        if (em.physics.walled[i] || em.physics.grounded[i])
+            em.stats.health[i] = 0.0f;
+    }
 }
 
 void ObjectDrawing(EntityManager &em, size_t i) {}
+
+// source has just started touching target
+static void ContactHit(EntityManager &em, size_t target, size_t source) {
+    float damage = em.vars[source].get(Var::DAMAGE);
+    if ((em.physics.layer[target] & Layer::DAMAGEABLE) && damage > 0.0f) {
+        em.stats.health[target] -= damage;
+        em.vars[target].set(Var::FLASH_TIME, 0.1f);
+    }
+
+    // Spent on the first thing it hits, like on a tile
+    if (em.rendering.typeID[source] == EntityTys::TYBULLET)
+        em.stats.health[source] = 0.0f;
+}
+
+void ContactSystem(EntityManager &em, std::span<const Contact> contacts) {
+    // Damage lands once per touch; staying in contact does nothing more
+    for (const Contact &c : contacts) {
+        if (c.phase != CONTACT_BEGIN)
+            continue;
+        size_t a = em.Resolve(c.a), b = em.Resolve(c.b);
+        if (a == EntityManager::InvalidIndex ||
+            b == EntityManager::InvalidIndex)
+            continue;
+        // Both wake: a hit only kills once the physics step sees it
+        em.Wake(a);
+        em.Wake(b);
+        ContactHit(em, a, b);
+        ContactHit(em, b, a);
+    }
+}
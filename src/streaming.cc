@@ -0,0 +1,328 @@
+#include "include/streaming.h"
+#include "include/data.h"
+#include "include/entities.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iterator>
+
+std::string LevelStreamer::ChunkPath(const std::string &dir, int cx, int cy) {
+    return dir + "/" + std::to_string(cx) + "_" + std::to_string(cy) +
+           ".lvl";
+}
+
+// --- Opening and closing ---
+
+bool LevelStreamer::Open(const std::string &path) {
+    Close();
+
+    std::error_code error;
+    std::filesystem::create_directories(path, error);
+    if (!std::filesystem::is_directory(path, error)) {
+        TraceLog(LOG_ERROR, "STREAM: Can't keep chunks in [%s]",
+                 path.c_str());
+        return false;
+    }
+
+    lm.Clear();
+    dir = path;
+    sinceSweep = 0;
+    worker = std::thread(&LevelStreamer::Work, this);
+    TraceLog(LOG_INFO, "STREAM: Streaming chunks from [%s]", path.c_str());
+    return true;
+}
+
+void LevelStreamer::Close() {
+    if (!IsOpen())
+        return;
+
+    // Reads in flight land first, so every chunk is either loaded or on
+    // disk; then all of it goes back, strays included
+    Wait();
+    std::vector<Job> batch = Capture(
+        [&](uint64_t key) {
+            auto it = chunks.find(key);
+            return it == chunks.end() ? MERGE : WRITE;
+        },
+        true);
+    Queue(batch);
+
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join(); // Drains the queue before it exits
+
+    stopping = false;
+    reads.clear();
+    chunks.clear();
+    loaded = 0;
+    dir.clear();
+    lm.Clear();
+}
+
+bool LevelStreamer::Split(const std::string &level, const std::string &dir) {
+    if (!lm.Load(level))
+        return false;
+
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    if (!std::filesystem::is_directory(dir, error)) {
+        TraceLog(LOG_ERROR, "STREAM: Can't keep chunks in [%s]", dir.c_str());
+        lm.Clear();
+        return false;
+    }
+    // Chunks left from an earlier split would come back otherwise
+    for (auto &entry : std::filesystem::directory_iterator(dir, error)) {
+        if (entry.path().extension() == ".lvl")
+            std::filesystem::remove(entry.path(), error);
+    }
+
+    LevelStreamer split;
+    std::vector<Job> batch =
+        split.Capture([](uint64_t) { return WRITE; }, true);
+    for (Job &job : batch)
+        Run(dir, job, nullptr);
+    lm.Clear();
+
+    TraceLog(LOG_INFO, "STREAM: Split [%s] into %zu chunks in [%s]",
+             level.c_str(), batch.size(), dir.c_str());
+    return true;
+}
+
+// --- Streaming ---
+
+void LevelStreamer::Update(Vector2 center) {
+    if (!IsOpen())
+        return;
+
+    SpawnReads();
+
+    int cx = ChunkOf(center.x), cy = ChunkOf(center.y);
+    std::vector<Job> batch;
+    for (int y = cy - loadRadius; y <= cy + loadRadius; ++y) {
+        for (int x = cx - loadRadius; x <= cx + loadRadius; ++x) {
+            auto [it, added] = chunks.try_emplace(Key(x, y));
+            if (!added)
+                continue;
+            it->second.ticket = ++nextTicket;
+            batch.push_back({READ, x, y, it->second.ticket, {}});
+        }
+    }
+
+    // Reads still in flight for chunks out of range are forgotten here and
+    // their results dropped by ticket; loaded ones are written out
+    int keep = std::max(unloadRadius, loadRadius);
+    std::vector<uint64_t> leaving;
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        int x = (int)(int32_t)(uint32_t)(it->first >> 32);
+        int y = (int)(int32_t)(uint32_t)it->first;
+        if (std::max(std::abs(x - cx), std::abs(y - cy)) <= keep) {
+            ++it;
+        } else if (it->second.loaded) {
+            leaving.push_back(it->first);
+            ++it;
+        } else {
+            it = chunks.erase(it);
+        }
+    }
+
+    // Entities only ever leave the loaded area by walking out, so they are
+    // swept up now and then rather than every frame
+    if (!leaving.empty() || ++sinceSweep >= StraySweep) {
+        sinceSweep = 0;
+        std::sort(leaving.begin(), leaving.end());
+        std::vector<Job> out = Capture(
+            [&](uint64_t key) {
+                auto it = chunks.find(key);
+                if (it == chunks.end())
+                    return MERGE;
+                if (it->second.loaded &&
+                    std::binary_search(leaving.begin(), leaving.end(), key))
+                    return WRITE;
+                return NONE;
+            },
+            true);
+        for (uint64_t key : leaving)
+            chunks.erase(key);
+        loaded -= leaving.size();
+        std::move(out.begin(), out.end(), std::back_inserter(batch));
+    }
+
+    Queue(batch);
+}
+
+void LevelStreamer::Flush() {
+    if (!IsOpen())
+        return;
+
+    std::vector<Job> batch = Capture(
+        [&](uint64_t key) {
+            auto it = chunks.find(key);
+            if (it == chunks.end())
+                return MERGE;
+            return it->second.loaded ? WRITE : NONE;
+        },
+        false);
+    Queue(batch);
+}
+
+void LevelStreamer::Wait() {
+    {
+        std::unique_lock<std::mutex> hold(lock);
+        idle.wait(hold, [&] { return busy == 0; });
+    }
+    SpawnReads();
+}
+
+size_t LevelStreamer::QueuedJobs() {
+    std::lock_guard<std::mutex> hold(lock);
+    return busy;
+}
+
+std::vector<LevelStreamer::Job>
+LevelStreamer::Capture(const std::function<JobKind(uint64_t)> &pick,
+                       bool remove) {
+    std::vector<Job> batch;
+    std::vector<std::vector<size_t>> rows; // Per job
+    std::unordered_map<uint64_t, size_t> jobOf; // SIZE_MAX: no job
+
+    // pick is asked once per chunk, not once per row
+    auto jobFor = [&](uint64_t key) {
+        auto [it, added] = jobOf.try_emplace(key, SIZE_MAX);
+        if (added) {
+            JobKind kind = pick(key);
+            if (kind != NONE) {
+                it->second = batch.size();
+                batch.push_back({kind, (int)(int32_t)(uint32_t)(key >> 32),
+                                 (int)(int32_t)(uint32_t)key, 0, {}});
+                rows.emplace_back();
+            }
+        }
+        return it->second;
+    };
+
+    // Loaded chunks get their job even when empty, so the file follows
+    for (auto const &[key, chunk] : chunks) {
+        if (chunk.loaded)
+            jobFor(key);
+    }
+
+    // Entities belong to the chunk their center is in
+    ForEachSet(em.physics.active, [&](size_t i) {
+        Vector2 pos = em.physics.pos[i], siz = em.physics.siz[i];
+        size_t job = jobFor(Key(ChunkOf(pos.x + siz.x * 0.5f),
+                                ChunkOf(pos.y + siz.y * 0.5f)));
+        if (job != SIZE_MAX)
+            rows[job].push_back(i);
+    });
+
+    // Stream chunks and tile chunks are the same squares
+    std::vector<uint64_t> tiles;
+    for (auto const &[key, c] : tmap.chunks) {
+        if (jobFor(key) != SIZE_MAX)
+            tiles.push_back(key);
+    }
+
+    std::vector<size_t> dead;
+    for (size_t k = 0; k < batch.size(); ++k) {
+        batch[k].snap.Take(rows[k]);
+        // Strays always leave the level, or they'd come back twice
+        if (remove || batch[k].kind == MERGE)
+            dead.insert(dead.end(), rows[k].begin(), rows[k].end());
+    }
+    for (uint64_t key : tiles) {
+        Job &job = batch[jobOf[key]];
+        job.snap.TakeTiles(job.cx, job.cy);
+        if (remove || job.kind == MERGE)
+            tmap.EraseChunk(job.cx, job.cy);
+    }
+    if (!dead.empty())
+        em.RemoveBatch(dead);
+
+    return batch;
+}
+
+void LevelStreamer::Queue(std::vector<Job> &batch) {
+    if (batch.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        busy += batch.size();
+        std::move(batch.begin(), batch.end(), std::back_inserter(jobs));
+    }
+    batch.clear();
+    wake.notify_one();
+}
+
+void LevelStreamer::SpawnReads() {
+    std::vector<Read> ready;
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        ready.swap(reads);
+    }
+
+    for (Read &read : ready) {
+        auto it = chunks.find(Key(read.cx, read.cy));
+        if (it == chunks.end() || it->second.loaded ||
+            it->second.ticket != read.ticket)
+            continue; // Left range while it was being read
+        lm.Spawn(read.level.View());
+        it->second.loaded = true;
+        ++loaded;
+    }
+}
+
+// --- Worker ---
+
+void LevelStreamer::Work() {
+    std::unique_lock<std::mutex> hold(lock);
+    for (;;) {
+        wake.wait(hold, [&] { return stopping || !jobs.empty(); });
+        if (jobs.empty())
+            return; // Stopping, and nothing left to write
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        hold.unlock();
+
+        LevelColumns level;
+        Run(dir, job, &level);
+
+        hold.lock();
+        if (job.kind == READ)
+            reads.push_back({job.cx, job.cy, job.ticket, std::move(level)});
+        if (--busy == 0)
+            idle.notify_all();
+    }
+}
+
+void LevelStreamer::Run(const std::string &dir, Job &job,
+                        LevelColumns *read) {
+    std::string path = ChunkPath(dir, job.cx, job.cy);
+
+    // A chunk nothing was ever saved in has no file
+    LevelColumns level;
+    std::error_code error;
+    if (job.kind != WRITE && std::filesystem::exists(path, error) &&
+        !ReadLevel(path, level))
+        TraceLog(LOG_ERROR, "STREAM: Failed reading chunk [%s]",
+                 path.c_str());
+
+    if (job.kind == READ) {
+        *read = std::move(level);
+        return;
+    }
+
+    job.snap.AppendTo(level);
+    if (level.typeID.empty() && level.tileX.empty()) {
+        std::remove(path.c_str());
+        return;
+    }
+    level.Sort();
+    if (!WriteLevel(path, level.View(), job.snap.Tiles()))
+        TraceLog(LOG_ERROR, "STREAM: Failed writing chunk [%s]",
+                 path.c_str());
+}
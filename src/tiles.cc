@@ -1,17 +1,255 @@
 #include "include/tiles.h"
+#include "include/assets.h"
 #include "include/data.h"
 #include "include/entities.h"
+#include <algorithm>
 #include <raylib.h>
 
-void TileSystem(EntityManager &em, size_t i) {
-    if (em.rendering.typeID[i] != EntityTys::TYTILE)
+// Layer of a tile type from its config; solid until configs are loaded
+static uint32_t TileLayer(uint16_t type) {
+    int t = GetDenseType(type);
+    const EntityConfig *cfg =
+        t >= 0 && t < (int)em.typeConfigs.size() ? em.typeConfigs[t] : nullptr;
+    return cfg ? cfg->layer : Layer::TILE;
+}
+
+void TileMap::Set(int x, int y, uint16_t type, uint8_t variant) {
+    if (type == 0) {
+        Erase(x, y);
+        return;
+    }
+
+    uint64_t key = ChunkKey(x >> 5, y >> 5);
+    size_t before = chunks.size();
+    TileChunk &c = chunks[key];
+    if (chunks.size() != before)
+        directoryStale = true;
+    int n = LocalIndex(x, y);
+    if (c.type[n] == 0) {
+        c.count++;
+        tileCount++;
+    }
+    if (c.type[n] != type) {
+        MarkDirty(key, c);
+        uint32_t bit = 1u << (x & (TileChunk::SIZE - 1));
+        if (TileLayer(type) & Layer::TILE)
+            c.solid[y & (TileChunk::SIZE - 1)] |= bit;
+        else
+            c.solid[y & (TileChunk::SIZE - 1)] &= ~bit;
+    }
+    c.type[n] = type;
+    c.variant[n] = variant;
+}
+
+void TileMap::Erase(int x, int y) {
+    auto it = chunks.find(ChunkKey(x >> 5, y >> 5));
+    if (it == chunks.end())
+        return;
+
+    TileChunk &c = it->second;
+    int n = LocalIndex(x, y);
+    if (c.type[n] == 0)
+        return;
+
+    c.type[n] = 0;
+    c.variant[n] = 0;
+    uint32_t bit = 1u << (x & (TileChunk::SIZE - 1));
+    c.solid[y & (TileChunk::SIZE - 1)] &= ~bit;
+    tileCount--;
+    if (--c.count == 0) {
+        chunks.erase(it);
+        directoryStale = true;
+    } else {
+        MarkDirty(it->first, c);
+    }
+}
+
+void TileMap::EraseChunk(int cx, int cy) {
+    auto it = chunks.find(ChunkKey(cx, cy));
+    if (it == chunks.end())
+        return;
+
+    // Still listed as dirty so the bake reports its area; it skips the
+    // chunk itself once it's gone
+    MarkDirty(it->first, it->second);
+    tileCount -= it->second.count;
+    chunks.erase(it);
+    directoryStale = true;
+}
+
+void TileMap::Clear() {
+    chunks.clear();
+    dirtyChunks.clear();
+    tileCount = 0;
+    RebuildDirectory();
+}
+
+void TileMap::RebuildDirectory() {
+    directory.clear();
+    dirX = dirY = dirW = dirH = 0;
+    dense = true;
+    directoryStale = false;
+    if (chunks.empty())
         return;
 
-    if (!em.physics.initialized[i]) {
-        em.rendering.col[i] = BLACK;
-        em.physics.gravity[i] = 0;
-        em.stats.maxHealth[i] = 100.0f;
+    int minX = INT32_MAX, minY = INT32_MAX, maxX = INT32_MIN, maxY = INT32_MIN;
+    for (auto const &[key, c] : chunks) {
+        int cx = (int)(int32_t)(uint32_t)(key >> 32);
+        int cy = (int)(int32_t)(uint32_t)key;
+        minX = std::min(minX, cx);
+        maxX = std::max(maxX, cx);
+        minY = std::min(minY, cy);
+        maxY = std::max(maxY, cy);
+    }
+
+    // Past a few empty slots per chunk the box costs more than the hash
+    int64_t w = (int64_t)maxX - minX + 1, h = (int64_t)maxY - minY + 1;
+    if (w * h > (int64_t)chunks.size() * 4 + 64) {
+        dense = false;
+        return;
+    }
+
+    dirX = minX;
+    dirY = minY;
+    dirW = (int)w;
+    dirH = (int)h;
+    directory.assign(w * h, nullptr);
+    for (auto const &[key, c] : chunks) {
+        int cx = (int)(int32_t)(uint32_t)(key >> 32);
+        int cy = (int)(int32_t)(uint32_t)key;
+        directory[(size_t)(cy - minY) * dirW + (cx - minX)] = &c;
+    }
+}
+
+void TileMap::MarkDirty(uint64_t key, TileChunk &c) {
+    if (c.dirty)
+        return;
+    c.dirty = true;
+    dirtyChunks.push_back(key);
+}
+
+void TileMap::BakeColliders(std::vector<Rectangle> *edited) {
+    const float span = TileChunk::SIZE * TILE_SIZE;
+    for (uint64_t key : dirtyChunks) {
+        int cx = (int)(int32_t)(uint32_t)(key >> 32);
+        int cy = (int)(int32_t)(uint32_t)key;
+        if (edited)
+            edited->push_back({cx * span, cy * span, span, span});
+
+        auto it = chunks.find(key);
+        if (it == chunks.end() || !it->second.dirty)
+            continue; // Emptied and dropped, or listed twice
+        BakeChunk(it->second, cx, cy);
+    }
+    dirtyChunks.clear();
+    if (directoryStale)
+        RebuildDirectory();
+}
+
+void TileMap::InvalidateColliders() {
+    for (auto &[key, c] : chunks)
+        MarkDirty(key, c);
+}
+
+void TileMap::BakeChunk(TileChunk &c, int cx, int cy) {
+    const int S = TileChunk::SIZE;
+    bool used[S * S] = {};
+    c.colliders.clear();
+    std::fill(std::begin(c.colliderOf), std::end(c.colliderOf), 0);
+    std::fill(std::begin(c.solid), std::end(c.solid), 0);
+
+    // Greedy: grow a run right as far as the type holds, then grow the run
+    // down while every cell of the next row matches too
+    for (int y = 0; y < S; ++y) {
+        for (int x = 0; x < S; ++x) {
+            uint16_t type = c.type[y * S + x];
+            if (type == 0 || used[y * S + x])
+                continue;
+
+            int w = 1;
+            while (x + w < S && c.type[y * S + x + w] == type &&
+                   !used[y * S + x + w])
+                ++w;
+
+            int h = 1;
+            for (; y + h < S; ++h) {
+                int row = (y + h) * S + x;
+                bool full = true;
+                for (int k = 0; k < w && full; ++k)
+                    full = c.type[row + k] == type && !used[row + k];
+                if (!full)
+                    break;
+            }
+
+            uint16_t id = (uint16_t)(c.colliders.size() + 1);
+            for (int dy = 0; dy < h; ++dy) {
+                for (int dx = 0; dx < w; ++dx) {
+                    used[(y + dy) * S + x + dx] = true;
+                    c.colliderOf[(y + dy) * S + x + dx] = id;
+                }
+            }
+
+            uint32_t layer = TileLayer(type);
+            c.colliders.push_back(
+                {{(cx * S + x) * TILE_SIZE, (cy * S + y) * TILE_SIZE,
+                  w * TILE_SIZE, h * TILE_SIZE},
+                 layer, type, (uint8_t)x, (uint8_t)y});
+
+            // Also refreshes the bitmap after a reload moved a type's layer
+            if (layer & Layer::TILE) {
+                uint32_t run = (w == S ? ~0u : ((1u << w) - 1)) << x;
+                for (int dy = 0; dy < h; ++dy)
+                    c.solid[y + dy] |= run;
+            }
+        }
+    }
+    c.dirty = false;
+}
+
+void TileMap::Draw(Camera2D camera) const {
+    Vector2 topLeft = GetScreenToWorld2D({0, 0}, camera);
+    Vector2 bottomRight = GetScreenToWorld2D(
+        {(float)GetScreenWidth(), (float)GetScreenHeight()}, camera);
+
+    int startX = CellOf(topLeft.x), endX = CellOf(bottomRight.x);
+    int startY = CellOf(topLeft.y), endY = CellOf(bottomRight.y);
+
+    Texture2D pixelTex = am.textures[TEX_DEF];
+
+    // Tiles of one type share a color; remember the last lookup
+    uint16_t lastType = 0;
+    Color col = BLACK;
+
+    for (int cy = startY >> 5; cy <= endY >> 5; ++cy) {
+        for (int cx = startX >> 5; cx <= endX >> 5; ++cx) {
+            const TileChunk *chunk = ChunkAt(cx, cy);
+            if (!chunk)
+                continue;
+            const TileChunk &c = *chunk;
+
+            int x0 = std::max(startX, cx * TileChunk::SIZE);
+            int x1 = std::min(endX, cx * TileChunk::SIZE + TileChunk::SIZE - 1);
+            int y0 = std::max(startY, cy * TileChunk::SIZE);
+            int y1 = std::min(endY, cy * TileChunk::SIZE + TileChunk::SIZE - 1);
+
+            for (int y = y0; y <= y1; ++y) {
+                for (int x = x0; x <= x1; ++x) {
+                    uint16_t type = c.type[LocalIndex(x, y)];
+                    if (type == 0)
+                        continue;
+
+                    if (type != lastType) {
+                        int t = GetDenseType(type);
+                        col = t >= 0 && em.typeConfigs[t]
+                                  ? em.typeConfigs[t]->color
+                                  : BLACK;
+                        lastType = type;
+                    }
 
-        em.physics.initialized[i] = true;
+                    DrawTexturePro(pixelTex, {0, 0, 1, 1}, CellRect(x, y),
+                                   {0, 0}, 0.0f, col);
+                }
+            }
+        }
     }
 }